@@ -4,691 +4,65 @@
 #include "ep_account.h"
 #include "ep_player.h"
 #include "ep_listener.h"
-#include "hl_md5.h"
-
-#pragma warning(push)
-#pragma warning(disable : 4146 4800)
-#include <mpirxx.h>
-#pragma warning(pop)
+#include "ep_session.h"
+#include "ep_reactor.h"
+#include "ep_acceptor.h"
+#include "ep_worker.h"
+#include "ep_timer.h"
+#include "ep_ticket.h"
+#include "ep_rsa.h"
 
 #include "../git-version.inl"
 
-const ServerVersionRec version_info{ SERVER_VERSIONINFO, sizeof(ServerVersionRec) - 3, { EP_VERSION } };
-
 account_list_t g_accounts;
 player_list_t g_players;
-socket_t g_server;
-
-void stop(int x);
+std::vector<std::unique_ptr<acceptor_t>> g_acceptors;
 
 packet_t g_keepalive_packet;
 packet_t g_auth_packet; // open key + sign
-mpz_class g_key_n; // open key
-mpz_class g_key_d; // priv key
+rsa_key_t g_key; // priv key
 u32 g_key_size = 0; // key size (bytes)
 
-bool only_online(player_t& player)
-{
-	return (player.account->flags & PF_OFF) == 0;
-}
-
-void receiver_thread(std::shared_ptr<socket_t> socket, std::shared_ptr<account_t> account, std::shared_ptr<player_t> player, std::shared_ptr<listener_t> listener)
+void receiver_thread(std::shared_ptr<socket_t> socket, std::shared_ptr<session_t> session)
 {
-	std::unique_ptr<listener_t, void(*)(listener_t*)> listener_stopper(listener.get(), [](listener_t* listener) // scope exit
-	{
-		listener->stop();
-	});
-
 	std::this_thread::sleep_for(std::chrono::seconds(1));
 
-	std::string cached_name;
-
-	auto set_online = [&]
-	{
-		const auto flags = account->flags.fetch_and(~PF_OFF);
-
-		if (flags & PF_OFF)
-		{
-			g_players.update_player(player, std::unique_lock<account_list_t>(g_accounts));
-
-			const auto& text = cached_name + "%/ is online.";
+	input_buffer_t input;
 
-			if (~account->flags & PF_SHADOWBAN)
-			{
-				g_players.broadcast(text, only_online);
-			}
-			else
-			{
-				player->broadcast(text);
-			}
-		}
-	};
-
-	auto set_offline = [&]
-	{
-		const auto flags = account->flags.fetch_or(PF_OFF);
-
-		if (~flags & PF_OFF)
-		{
-			g_players.update_player(player, std::unique_lock<account_list_t>(g_accounts));
-
-			const auto& text = cached_name + "%/ is offline.";
-
-			if (~account->flags & PF_SHADOWBAN)
-			{
-				g_players.broadcast(text, only_online);
-			}
-
-			player->broadcast(text);
-		}
-	};
-
-	ProtocolHeader header;
-	ClientCmdRec cmd;
-
-	while (socket->flush(), socket->get(header))
+	while (true)
 	{
-		// TODO: reset last activity time
-
-		// Update cached name
-		if (!(account->uniq_name.size() != 0 && account->uniq_name == cached_name) && !(account->name == cached_name))
-		{
-			cached_name = account->get_name(std::unique_lock<account_list_t>(g_accounts));
-		}
+		ProtocolHeader header;
+		std::size_t size;
 
-		if (header.code == CLIENT_CMD && header.size >= 14)
+		// process all complete messages
+		while (input.get_frame(*socket, header, size))
 		{
-			const u16 text_size = header.size - 14;
-
-			if (!socket->get(&cmd, header.size))
+			// commands are executed in the worker pool
+			if (!session->submit(header, input.get_buffer(), input.data() + sizeof(ProtocolHeader), true))
 			{
 				return;
 			}
 
-			switch (cmd.cmd)
-			{
-			case CMD_NONE: break;
-
-			case CMD_CHAT:
-			{
-				const std::string message(cmd.data, text_size);
-
-				if (message.find("%p") != std::string::npos)
-				{
-					listener->push_text("You cannot send %%p marker.");
-					listener->push_text(message);
-				}
-				else if (message.find("%/") != std::string::npos)
-				{
-					listener->push_text("You cannot send %%/ marker.");
-					listener->push_text(message);
-				}
-				else if (cmd.v0 == -1 && !cmd.v1 && !cmd.v2)
-				{
-					// public message
-					if (account->flags & PF_NOCHAT)
-					{
-						listener->push_text("You cannot write public messages.");
-						listener->push_text(message);
-					}
-					else
-					{
-						set_online();
-
-						const auto& text = message.substr(0, 4) == "/me " || message.substr(0, 4) == u8"/я "
-							? cached_name + "%/ " + message.substr(4)
-							: cached_name + "%/ %bwrites:%x " + message;
-
-						if (~account->flags & PF_SHADOWBAN)
-						{
-							g_players.broadcast(text, only_online);
-						}
-						else
-						{
-							player->broadcast(text);
-						}
-					}
-
-					// ~207 ms + 1 ms per character
-					std::this_thread::sleep_for(std::chrono::milliseconds(200 + header.size));
-				}
-				else if (cmd.v0 >= 0 && !cmd.v1 && !cmd.v2)
-				{
-					// private message
-					if (account->flags & PF_NOPRIVCHAT)
-					{
-						listener->push_text("You cannot write private messages.");
-						listener->push_text(message);
-					}
-					else if (const auto target = g_players.get_player(cmd.v0))
-					{
-						if (~account->flags & PF_SHADOWBAN || player == target)
-						{
-							target->broadcast(cached_name + "%/%p%g writes (private):%x " + message);
-						}
-					}
-					else
-					{
-						listener->push_text("Invalid player.");
-					}
-
-					// ~201 ms + 0.25 ms per character
-					std::this_thread::sleep_for(std::chrono::milliseconds(200 + header.size / 4));
-				}
-				else
-				{
-					listener->push_text("Invalid arguments.");
-				}
-				break;
-			}
-			case CMD_DICE:
-			{
-				if (cmd.v0 == -1 && !cmd.v2)
-				{
-					// public dice
-					if (account->flags & PF_NOCHAT)
-					{
-						listener->push_text("You cannot write public messages.");
-					}
-					else
-					{
-						set_online();
-
-						const auto& text = cached_name + "%/ throws " + FormatDice(cmd.v1);
-
-						if (~account->flags & PF_SHADOWBAN)
-						{
-							g_players.broadcast(text, only_online);
-						}
-						else
-						{
-							player->broadcast(text);
-						}
-					}
-
-					// 200 ms
-					std::this_thread::sleep_for(std::chrono::milliseconds(200));
-				}
-				else if ((cmd.v0 == -2 || cmd.v0 == player->index) && !cmd.v2)
-				{
-					// self dice
-					listener->push_text("You throw " + FormatDice(cmd.v1));
-				}
-				else if (cmd.v0 >= 0 && !cmd.v2)
-				{
-					// private dice
-					if (account->flags & PF_NOPRIVCHAT)
-					{
-						listener->push_text("You cannot write private messages.");
-					}
-					else if (const auto target = g_players.get_player(cmd.v0))
-					{
-						const std::string& dice = FormatDice(cmd.v1);
-
-						if (~account->flags & PF_SHADOWBAN)
-						{
-							target->broadcast(cached_name + "%/%p throws " + dice + " to you (private)");
-						}
-
-						listener->push_text("You throw " + dice + "%/ to " + target->account->get_name(std::unique_lock<account_list_t>(g_accounts)));
-					}
-					else
-					{
-						listener->push_text("Invalid player.");
-					}
-
-					// 200 ms
-					std::this_thread::sleep_for(std::chrono::milliseconds(200));
-				}
-				else
-				{
-					listener->push_text("Invalid arguments.");
-				}
-				break;
-			}
-			case CMD_SHOUT:
-			{
-				if (account->flags & PF_SUPERADMIN)
-				{
-					g_players.broadcast(cached_name + "%/ %bwrites:%x " + std::string(cmd.data, text_size));
-				}
-				else
-				{
-					listener->push_text("Check your privilege.");
-				}
-				break;
-			}
-			case CMD_SET_EMAIL:
-			{
-				if (cmd.v0 == -1 && !cmd.v1 && !cmd.v2)
-				{
-					{
-						std::unique_lock<account_list_t> acc_lock(g_accounts);
-
-						account->email = { cmd.data, text_size };
-
-						g_accounts.save(acc_lock);
-					}
-
-					listener->push_text("E-mail set:");
-					listener->push_text({ cmd.data, std::min<u16>(255, text_size) });
-
-					std::this_thread::sleep_for(std::chrono::seconds(1));
-				}
-				else if (!cmd.v1 && !cmd.v2)
-				{
-					if (account->flags & PF_SUPERADMIN)
-					{
-						// find cmd.v0 player and set email
-						if (const auto target = g_players.get_player(cmd.v0))
-						{
-							{
-								std::unique_lock<account_list_t> acc_lock(g_accounts);
-
-								target->account->email = { cmd.data, text_size };
-
-								g_accounts.save(acc_lock);
-							}
-
-							listener->push_text("E-mail set:"); // TODO (message)
-							listener->push_text({ cmd.data, std::min<u16>(255, text_size) });
-						}
-						else
-						{
-							listener->push_text("Invalid player.");
-						}
-					}
-					else
-					{
-						listener->push_text("Check your privilege.");
-					}
-				}
-				else
-				{
-					listener->push_text("Invalid arguments.");
-				}
-				break;
-			}
-			case CMD_SET_PASSWORD:
-			{
-				if (cmd.v0 == -1 && !cmd.v1 && !cmd.v2 && text_size > 16)
-				{
-					// check old password and set new one
-					md5_t old;
-
-					// calculate md5(md5(password))
-					HL_MD5_CTX ctx;
-					MD5().MD5Init(&ctx);
-					MD5().MD5Update(&ctx, reinterpret_cast<unsigned char*>(cmd.data) + 16, text_size - 16);
-					MD5().MD5Final(old.data(), &ctx);
-					MD5().MD5Init(&ctx);
-					MD5().MD5Update(&ctx, old.data(), 16);
-					MD5().MD5Final(old.data(), &ctx);
-
-					if (old == account->pass)
-					{
-						{
-							std::unique_lock<account_list_t> acc_lock(g_accounts);
-
-							account->pass = *reinterpret_cast<md5_t*>(cmd.data);
-
-							g_accounts.save(acc_lock);
-						}
-
-						listener->push_text("Password updated.");
-					}
-					else
-					{
-						listener->push_text("Invalid password.");
-					}
-
-					std::memset(cmd.data, 0, text_size);
-
-					std::this_thread::sleep_for(std::chrono::seconds(4));
-				}
-				else if (!cmd.v1 && !cmd.v2 && text_size == 16)
-				{
-					if (account->flags & PF_SUPERADMIN)
-					{
-						// find cmd.v0 player and reset password
-						if (const auto target = g_players.get_player(cmd.v0))
-						{
-							{
-								std::unique_lock<account_list_t> acc_lock(g_accounts);
-
-								target->account->pass = *reinterpret_cast<md5_t*>(cmd.data);
-
-								g_accounts.save(acc_lock);
-							}
-
-							listener->push_text("Password updated."); // TODO (message)
-						}
-						else
-						{
-							listener->push_text("Invalid player.");
-						}						
-					}
-					else
-					{
-						listener->push_text("Check your privilege.");
-					}
-				}
-				else
-				{
-					listener->push_text("Invalid arguments.");
-				}
-				break;
-			}
-			case CMD_SET_FLAG:
-			{
-				if (account->flags & PF_SUPERADMIN)
-				{
-					const u64 flag = 1ull << cmd.v1;
-
-					if (cmd.v1 < 64u && flag != PF_SUPERADMIN && !cmd.v2)
-					{
-						// find cmd.v0 player and change flag
-						if (const auto target = g_players.get_player(cmd.v0))
-						{
-							std::unique_lock<account_list_t> acc_lock(g_accounts);
-
-							// TODO (message)
-
-							const u64 _flags = target->account->flags ^= flag;
-
-							if ((flag & PF_HIDDEN_FLAGS) == 0)
-							{
-								target->broadcast("Flag [" + std::string(FlagName[cmd.v1]) + (_flags & flag ? "] has been set." : "] has been removed."));
-							}
-
-							listener->push_text("Flags: " + FormatFlags(_flags));
-
-							g_players.update_player(target, acc_lock);
-
-							g_accounts.save(acc_lock);
-						}
-						else
-						{
-							listener->push_text("Invalid player.");
-						}
-					}
-					else
-					{
-						listener->push_text("Invalid arguments.");
-					}
-				}
-				else
-				{
-					listener->push_text("Check your privilege.");
-				}
-				break;
-			}
-			case CMD_DISCONNECT:
-			{
-				if (account->flags & PF_SUPERADMIN)
-				{
-					// find cmd.v0 player and disconnect it
-					if (const auto target = g_players.get_player(cmd.v0))
-					{
-						listener->push_text("Not implemented.");
-					}
-					else
-					{
-						listener->push_text("Invalid player.");
-					}
-				}
-				else
-				{
-					listener->push_text("Check your privilege.");
-				}
-				break;
-			}
-			case CMD_INFO:
-			{
-				if (account->flags & PF_SUPERADMIN)
-				{
-					// find cmd.v0 player and display information
-					if (const auto target = g_players.get_player(cmd.v0))
-					{
-						std::lock_guard<account_list_t> acc_lock(g_accounts);
-
-						std::string info;
-
-						info += "\nLogin: ";
-						info += target->account->name;
-						info += "\nName: ";
-						info += target->account->uniq_name;
-						info += "\nEmail: ";
-						info += target->account->email;
-						info += "\nFlags: ";
-						info += FormatFlags(target->account->flags);
-						
-						target->append_connection_info(info);
-
-						listener->push_text(info);
-					}
-					else
-					{
-						listener->push_text("Invalid player.");
-					}
-				}
-				else
-				{
-					listener->push_text("Check your privilege.");
-				}
-				break;
-			}
-			case CMD_CHANGE:
-			{
-				if (account->flags & PF_SUPERADMIN)
-				{
-					if (const auto target = g_players.get_player(cmd.v0))
-					{
-						listener->push_text("Not implemented.");
-					}
-					else
-					{
-						listener->push_text("Invalid player.");
-					}
-				}
-				else
-				{
-					listener->push_text("Check your privilege.");
-				}
-				break;
-			}
-			case CMD_SET_NAME:
-			{
-				if (account->flags & PF_SUPERADMIN)
-				{
-					// find cmd.v0 player and set unique name
-					if (const auto target = g_players.get_player(cmd.v0))
-					{
-						{
-							std::unique_lock<account_list_t> acc_lock(g_accounts);
-
-							target->account->uniq_name = { cmd.data, text_size };
-
-							g_players.update_player(target, acc_lock);
-
-							g_accounts.save(acc_lock);
-						}
-
-						listener->push_text("Unique name set:"); // TODO (message)
-						listener->push_text({ cmd.data, std::min<u16>(48, text_size) });
-					}
-					else
-					{
-						listener->push_text("Invalid player.");
-					}
-				}
-				else
-				{
-					listener->push_text("Check your privilege.");
-				}
-				break;
-			}
-			case CMD_CALL:
-			{
-				if (account->flags & PF_SUPERADMIN)
-				{
-					// forcedly load player by login
-					listener->push_text("Not implemented.");
-				}
-				else
-				{
-					listener->push_text("Check your privilege.");
-				}
-				break;
-			}
-			case CMD_SET_NOTE:
-			{
-				if (account->flags & PF_SUPERADMIN)
-				{
-					// set new greeting message
-					listener->push_text("Not implemented.");
-				}
-				else
-				{
-					listener->push_text("Check your privilege.");
-				}
-				break;
-			}
-			case CMD_ADD_BAN:
-			{
-				if (account->flags & PF_SUPERADMIN)
-				{
-					// ban ip address
-					listener->push_text("Not implemented.");
-				}
-				else
-				{
-					listener->push_text("Check your privilege.");
-				}
-				break;
-			}
-			case CMD_CREATE_GAME:
-			{
-				listener->push_text("Not implemented.");
-				break;
-			}
-			case CMD_DELETE_GAME:
-			{
-				listener->push_text("Not implemented.");
-				break;
-			}
-			case CMD_GAME_OWNER:
-			{
-				listener->push_text("Not implemented.");
-				break;
-			}
-			case CMD_ADD_PLAYER:
-			{
-				listener->push_text("Not implemented.");
-				break;
-			}
-			case CMD_DELETE_PLAYER:
-			{
-				listener->push_text("Not implemented.");
-				break;
-			}
-			case CMD_JOIN_GAME:
-			{
-				listener->push_text("Not implemented.");
-				break;
-			}
-			default:
-			{
-				listener->push_text(fmt::format("Invalid command (cmd={:#x}, v0={:#x}, v1={:#x}, v2={:#x})", cmd.cmd, cmd.v0, cmd.v1, cmd.v2));
-			}
-			}
+			input.consume(size);
 		}
-		else if (header.code == CLIENT_SCMD && header.size == 2)
-		{
-			u16 scmd;
-			if (!socket->get(scmd))
-			{
-				return;
-			}
 
-			switch (scmd)
-			{
-			case SCMD_NONE: break;
-
-			case SCMD_UPDATE_SERVER:
-			{
-				if (account->flags & PF_SUPERADMIN)
-				{
-					// restart server (TODO)
-					stop(0);
-				}
-				else
-				{
-					listener->push_text("Check your privilege.");
-				}
-				break;
-			}
-			case SCMD_HIDE:
-			{
-				set_offline();
-				std::this_thread::sleep_for(std::chrono::milliseconds(300));
-				break;
-			}
-			case SCMD_SHOW:
-			{
-				set_online();
-				std::this_thread::sleep_for(std::chrono::milliseconds(300));
-				break;
-			}
-			case SCMD_REFRESH:
-			{
-				// Update player list (it shouldn't be necessary to use it)
-				listener->push_packet(g_players.generate_player_list(player->index, std::unique_lock<account_list_t>(g_accounts)));
+		const auto buf = input.reserve(4096);
+		const int res = socket->receive(buf, input.space());
 
-				std::this_thread::sleep_for(std::chrono::seconds(1));
-				break;
-			}
-			case SCMD_QUIT:
-			{
-				// Quit manually
-
-				if (account->flags & PF_LOCK)
-				{
-					listener->push_text("You cannot quit now.");
-					return;
-				}
-
-				listener->push_text("You have quit.");
-				listener->quit_flag.test_and_set();
-				return;
-			}
-
-			default:
-			{
-				listener->push_text(fmt::format("Invalid command (scmd={:#x})", scmd));
-			}
-			}
-		}
-		else
+		if (res <= 0)
 		{
-			listener->push_text(fmt::format("Invalid command (code={:#x}, size={})", +header.code, header.size));
-
-			if (!socket->get(&cmd, header.size))
-			{
-				return;
-			}
+			break;
 		}
+
+		input.commit(res);
 	}
+
+	session->finish();
 }
 
 void sender_thread(std::shared_ptr<socket_t> socket, inaddr_t ip, u16 port)
 {
-	auto message = [](socket_t& socket, const char* text)
-	{
-		const packet_t& packet = ServerTextRec::make(GetTime(), text, strlen(text));
-
-		socket.put(packet->data(), packet->size);
-	};
+	ep_printf_ip("+\n", ip, port);
 
 	ProtocolHeader header;
 
@@ -699,178 +73,60 @@ void sender_thread(std::shared_ptr<socket_t> socket, inaddr_t ip, u16 port)
 		return;
 	}
 
-	std::shared_ptr<account_t> account;
+	packet_t auth_info;
 
+	if (session_t::check_auth(header) && (auth_info.reset(header.size), !socket->get(auth_info->data(), header.size)))
 	{
-		packet_t auth_info;
-
-		// validate auth packet content
-		if ((g_key_size != 0 || header.code != CLIENT_AUTH || header.size != sizeof(ClientAuthRec)) &&
-			(g_key_size == 0 || header.code != CLIENT_SECURE_AUTH || header.size != g_key_size) ||
-			(auth_info.reset(header.size), !socket->get(auth_info->data(), header.size)))
-		{
-			ep_printf_ip("- (AUTH-2) ({}, {})\n", ip, port, +header.code, header.size);
-			message(*socket, "Handshake failed.");
-			socket->put(ProtocolHeader{ SERVER_NONFATALDISCONNECT });
-			return;
-		}
-
-		// select auth mode
-		if (header.code == CLIENT_SECURE_AUTH)
-		{
-			mpz_class num;
-
-			for (u32 i = 0; i < g_key_size; i++) // convert from base 256
-			{
-				num <<= 8;
-				num += auth_info->get<u8>(i);
-			}
-
-			mpz_powm(num.get_mpz_t(), num.get_mpz_t(), g_key_d.get_mpz_t(), g_key_n.get_mpz_t()); // decrypt
-
-			for (u32 i = g_key_size - 1; ~i; i--) // get decrypted data
-			{
-				auth_info->get<u8>(i) = static_cast<u8>(num.get_ui());
-				num >>= 8;
-
-				if (num == 0)
-				{
-					// fix data displacement (allocate new block)
-					auth_info = { &auth_info->get(i), g_key_size - i };
-					break;
-				}
-			}
-
-			if (auth_info->size < sizeof(SecureAuthRec))
-			{
-				// clear invalid data (proceed with empty login)
-				std::memset(auth_info->data(), 0, auth_info->size);
-			}
-			else
-			{
-				// re-initialize with encryption
-				socket = std::make_shared<cipher_socket_t>(socket->release(), packet_t{ auth_info->get<SecureAuthRec>().ckey, 32 });
-			}
-		}
-
-		auto& auth = auth_info->get<ClientAuthRec>();
-
-		// check login
-		if (auth.name.size() > 16 || !IsLoginValid(auth.name.data(), auth.name.size()))
-		{
-			ep_printf_ip("- (AUTH-3) ({})\n", ip, port, auth.name.size());
-			message(*socket, "Invalid login.");
-			socket->put(ProtocolHeader{ SERVER_DISCONNECT });
-			return;
-		}
-
-		// prepare password
-		HL_MD5_CTX ctx;
-		MD5().MD5Init(&ctx);
-		MD5().MD5Update(&ctx, auth.pass.data(), 16); // calculate md5 from md5(password) arrived
-		MD5().MD5Final(auth.pass.data(), &ctx);
-
-		ep_printf_ip("* LOGIN: {}\n", ip, port, auth.name.operator std::string());
-
-		// find or create account
-		if (!(account = g_accounts.add_account(auth.name, auth.pass)))
-		{
-			ep_printf_ip("- (AUTH-4)\n", ip, port);
-			message(*socket, "Invalid password.");
-			socket->put(ProtocolHeader{ SERVER_DISCONNECT });
-			return;
-		}
+		auth_info.reset();
 	}
 
-	if (account->flags & PF_NOCONNECT)
+	if (auth_info && header.code == CLIENT_SECURE_AUTH)
 	{
-		ep_printf_ip("- (AUTH-5)\n", ip, port);
-		message(*socket, "Account is banned.");
-		socket->put(ProtocolHeader{ SERVER_DISCONNECT });
-		return;
-	}
+		// wait for decryption in the crypto pool (auth is rejected if it's overloaded)
+		const auto result = std::make_shared<std::promise<packet_t>>();
+		auto future = result->get_future();
 
-	auto player = g_players.add_player(account);
+		const bool posted = session_t::decrypt_auth(std::move(auth_info), [result](packet_t data)
+		{
+			result->set_value(std::move(data));
+		});
 
-	if (!player)
-	{
-		ep_printf_ip("- (AUTH-6)\n", ip, port);
-		message(*socket, "Too many players connected.");
-		socket->put(ProtocolHeader{ SERVER_DISCONNECT });
-		return;
+		auth_info = posted ? future.get() : packet_t{};
 	}
 
-	auto listener = std::make_shared<listener_t>(ip.s_addr, port, header.code == CLIENT_SECURE_AUTH);
+	const auto session = session_t::login(socket, ip, port, header, std::move(auth_info));
 
-	if (!player->add_listener(listener))
+	if (!session)
 	{
-		ep_printf_ip("- (AUTH-7)\n", ip, port);
-		message(*socket, "Too many connections.");
-		socket->put(ProtocolHeader{ SERVER_DISCONNECT });
 		return;
 	}
 
-	// send version information
-	listener->push(version_info);
+	// start receiver subthread (it shouldn't send data directly)
+	std::thread(receiver_thread, socket, session).detach();
 
-	listener->push_text("EPServer git version: " GIT_VERSION); // TODO: print greeting and something else
+	// start sending packets (keepalive packets are pushed by the session timer)
+	std::vector<packet_t> packets;
 
+	while (true)
 	{
-		std::unique_lock<account_list_t> acc_lock(g_accounts);
-
-		// send player list
-		listener->push_packet(g_players.generate_player_list(player->index, acc_lock));
+		packets.clear();
+		session->listener->pop_all(packets);
 
-		if (account->flags.fetch_and(~PF_NEW_PLAYER) & PF_NEW_PLAYER) // new player connected
-		{
-			g_players.update_player(player, acc_lock);
-			g_players.broadcast(account->get_name(acc_lock) + "%/ connected as a new player.", only_online);
-			g_accounts.save(acc_lock);
-		}
-		else if (account->flags.fetch_and(~PF_LOST) & PF_LOST) // connection restored
+		// empty packet is the stop message
+		const auto stop = std::find_if(packets.begin(), packets.end(), [](const packet_t& packet)
 		{
-			g_players.update_player(player, acc_lock);
-			g_players.broadcast(account->get_name(acc_lock) + "%/ connected.", only_online);
-		}
-		else
-		{
-			g_players.update_player(player, acc_lock); // silent reconnection
-		}
-	}
+			return !packet;
+		});
 
-	// start receiver subthread (it shouldn't send data directly)
-	std::thread(receiver_thread, socket, account, player, listener).detach();
-
-	// start sending packets
-	while (packet_t packet{ listener->pop(30000, g_keepalive_packet) })
-	{
-		if (!socket->put(packet->data(), packet->size))
+		if (!socket->put_packets(packets.data(), stop - packets.begin()) || stop != packets.end())
 		{
 			break;
 		}
-	}
-
-	// detect connection lost
-	if (player->remove_listener(listener) == PS_CONNECTION_LOST)
-	{
-		std::unique_lock<account_list_t> acc_lock(g_accounts);
 
-		// check if the quit command has been sent
-		if (listener->quit_flag.test_and_set())
-		{
-			g_players.broadcast(account->get_name(acc_lock) + "%/ has quit.", only_online);
-			g_players.update_player(player, acc_lock, true);
-			g_players.remove_player(player->index);
-		}
-		else
-		{
-			g_players.update_player(player, acc_lock);
-			g_players.broadcast(account->get_name(acc_lock) + "%/ lost connection with server.", only_online);
-		}
+		session->send_time = get_time_ms();
 	}
 
-	// close connection
-	socket->put(ProtocolHeader{ listener->stop_flag.test_and_set() ? SERVER_DISCONNECT : SERVER_NONFATALDISCONNECT });
+	session->disconnect(*socket);
 	ep_printf_ip("-\n", ip, port);
 }
 
@@ -881,11 +137,24 @@ void stop(int x)
 
 	std::this_thread::sleep_for(std::chrono::seconds(1));
 
-	std::unique_lock<account_list_t> acc_lock(g_accounts);
-	
-	g_accounts.save(acc_lock);
-	acc_lock.release(); // leave locked
-	g_server.close();
+	// accounts are saved by main() after the worker pools are stopped
+	for (auto& acceptor : g_acceptors)
+	{
+		acceptor->close();
+	}
+}
+
+void append_server_info(std::string& info)
+{
+	for (auto& acceptor : g_acceptors)
+	{
+		acceptor->append_info(info);
+	}
+
+	g_players.append_stats(info);
+	flood_control_t::append_stats(info);
+	listener_t::append_stats(info);
+	session_t::append_stats(info);
 }
 
 void fault(int x)
@@ -900,6 +169,67 @@ int main(int arg_count, const char* args[])
 {
 	ep_printf("EPServer started.\n");
 
+	bool use_reactor = false; // use epoll event loop instead of two threads per connection
+	bool use_uring = false; // use io_uring instead of epoll
+	u32 acceptor_count = 1; // number of accept threads (SO_REUSEPORT is used if more than one)
+	u32 worker_count = std::max<u32>(std::thread::hardware_concurrency(), 1); // command execution threads
+	u32 crypto_count = std::max<u32>(std::thread::hardware_concurrency() / 2, 1); // handshake decryption threads
+	u32 crypto_queue = 256; // max pending handshakes (others are rejected)
+	u32 ticket_lifetime = 3600; // session ticket lifetime in seconds (0 disables resumption)
+
+	for (int i = 1; i < arg_count; i++)
+	{
+		if (std::strcmp(args[i], "--reactor") == 0)
+		{
+			use_reactor = true;
+		}
+		else if (std::strcmp(args[i], "--uring") == 0)
+		{
+			use_reactor = true;
+			use_uring = true;
+		}
+		else if (std::strcmp(args[i], "--acceptors") == 0 && i + 1 < arg_count)
+		{
+			acceptor_count = std::max<u32>(std::strtoul(args[++i], nullptr, 10), 1);
+		}
+		else if (std::strcmp(args[i], "--workers") == 0 && i + 1 < arg_count)
+		{
+			worker_count = std::max<u32>(std::strtoul(args[++i], nullptr, 10), 1);
+		}
+		else if (std::strcmp(args[i], "--crypto-threads") == 0 && i + 1 < arg_count)
+		{
+			crypto_count = std::max<u32>(std::strtoul(args[++i], nullptr, 10), 1);
+		}
+		else if (std::strcmp(args[i], "--crypto-queue") == 0 && i + 1 < arg_count)
+		{
+			crypto_queue = std::max<u32>(std::strtoul(args[++i], nullptr, 10), 1);
+		}
+		else if (std::strcmp(args[i], "--ticket-lifetime") == 0 && i + 1 < arg_count)
+		{
+			ticket_lifetime = std::strtoul(args[++i], nullptr, 10);
+		}
+		else if (std::strcmp(args[i], "--idle-timeout") == 0 && i + 1 < arg_count)
+		{
+			g_idle_timeout = std::strtoul(args[++i], nullptr, 10);
+		}
+		else if (std::strcmp(args[i], "--queue-limit") == 0 && i + 1 < arg_count)
+		{
+			g_queue_limit = std::strtoul(args[++i], nullptr, 10);
+		}
+		else if (std::strcmp(args[i], "--queue-size-limit") == 0 && i + 1 < arg_count)
+		{
+			g_queue_size_limit = std::strtoul(args[++i], nullptr, 10);
+		}
+		else if (std::strcmp(args[i], "--queue-resync") == 0)
+		{
+			g_queue_resync = true;
+		}
+		else
+		{
+			fmt::print("Unknown option: {}\n", args[i]);
+		}
+	}
+
 	if (std::signal(SIGINT, stop) == SIG_ERR)
 	{
 		ep_printf("signal(SIGINT) failed!\n");
@@ -969,15 +299,9 @@ int main(int arg_count, const char* args[])
 			mpz_class key_n(strings[3], 10);
 			mpz_class key_s(strings[4], 10);
 
-			// set open key
-			g_key_n = key_n;
-
-			// calculate priv key
-			g_key_d = (key_p - 1) * (key_q - 1);
-			mpz_invert(g_key_d.get_mpz_t(), key_e.get_mpz_t(), g_key_d.get_mpz_t());
-
-			// set rough key size
-			g_key_size = static_cast<u32>(mpz_size(g_key_d.get_mpz_t()) * sizeof(mp_limb_t));
+			// calculate priv key (n is p * q)
+			g_key.set(key_e, key_p, key_q);
+			g_key_size = g_key.size;
 
 			// prepare auth packet
 			g_auth_packet.reset(3 + g_key_size * 2);
@@ -1000,7 +324,7 @@ int main(int arg_count, const char* args[])
 
 	fmt::print("key size: {}\n", g_key_size * 8);
 
-	if (g_auth_packet->size == 0)
+	if (!g_auth_packet)
 	{
 		g_auth_packet.reset(3);
 		g_auth_packet->get<ProtocolHeader>() = { SERVER_AUTH };
@@ -1024,47 +348,113 @@ int main(int arg_count, const char* args[])
 	});
 #endif
 
-	socket_id_t sid = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-	if (sid == INVALID_SOCKET)
+	g_timers.start();
+	g_workers.start(worker_count);
+
+	fmt::print("workers: {}\n", worker_count);
+
+	if (g_key_size)
 	{
-		fmt::print("socket() failed: {:#x}\n", GETERROR);
-		return -1;
-	}
+		g_crypto.start(crypto_count, crypto_queue);
 
-	g_server.reset(sid);
+		fmt::print("crypto threads: {} (queue: {})\n", crypto_count, crypto_queue);
 
-	sockaddr_in info;
-	info.sin_family = AF_INET;
-	info.sin_addr.s_addr = INADDR_ANY;
-	info.sin_port = htons(4044);
+		if (ticket_lifetime)
+		{
+			g_tickets.start(ticket_lifetime);
 
-	if (bind(sid, reinterpret_cast<sockaddr*>(&info), sizeof(sockaddr_in)) == SOCKET_ERROR)
-	{
-		fmt::print("bind() failed: {:#x}\n", GETERROR);
-		return -1;
+			fmt::print("session tickets: {} s\n", ticket_lifetime);
+		}
 	}
 
-	if (listen(sid, SOMAXCONN) == SOCKET_ERROR)
+#ifdef __linux__
+	std::vector<std::shared_ptr<reactor_t>> reactors; // also kept by acceptor handlers until static destruction
+#endif
+
+	// reactor threads and broadcast callbacks must not run after main() returns
+	auto stop_reactors = [&]()
 	{
-		fmt::print("listen() failed: {:#x}\n", GETERROR);
-		return -1;
-	}
+#ifdef __linux__
+		for (auto& reactor : reactors)
+		{
+			reactor->stop();
+		}
+#endif
+	};
 
-	while (true)
+	for (u32 i = 0; i < acceptor_count; i++)
 	{
-		// accept connection
-		socklen_t size = sizeof(sockaddr_in);
-		socket_id_t aid = accept(sid, reinterpret_cast<sockaddr*>(&info), &size);
+		std::function<void(socket_id_t, inaddr_t, u16)> handler = [](socket_id_t socket, inaddr_t ip, u16 port)
+		{
+			// start client thread
+			std::thread(sender_thread, std::make_shared<socket_t>(socket), ip, port).detach();
+		};
+
+#ifdef __linux__
+		if (use_reactor)
+		{
+			// each acceptor has its own reactor
+			std::shared_ptr<reactor_t> reactor(new reactor_t);
+
+			if (!reactor->start(use_uring))
+			{
+				stop_reactors();
+				return -1;
+			}
+
+			reactors.emplace_back(reactor);
+
+			handler = [reactor](socket_id_t socket, inaddr_t ip, u16 port)
+			{
+				reactor->add(socket, ip, port);
+			};
+		}
+#endif
+
+		g_acceptors.emplace_back(new acceptor_t(i, std::move(handler)));
 
-		if (aid == INVALID_SOCKET)
+		if (!g_acceptors.back()->open(4044, acceptor_count > 1))
 		{
-			ep_printf("EPServer stopped.\n");
-			return 0;
+			stop_reactors();
+			return -1;
 		}
+	}
 
-		ep_printf_ip("+\n", info.sin_addr, info.sin_port);
+#ifdef __linux__
+	if (use_reactor)
+	{
+		fmt::print("Reactor mode enabled.\n");
+	}
+#else
+	if (use_reactor)
+	{
+		fmt::print("Reactor mode is not supported on this platform.\n");
+	}
+#endif
 
-		// start client thread
-		std::thread(sender_thread, std::make_shared<socket_t>(aid), info.sin_addr, info.sin_port).detach();
+	if (acceptor_count > 1)
+	{
+		fmt::print("acceptors: {}\n", acceptor_count);
 	}
+
+	for (u32 i = 1; i < acceptor_count; i++)
+	{
+		std::thread(&acceptor_t::run, g_acceptors[i].get()).detach();
+	}
+
+	g_acceptors[0]->run();
+
+	g_timers.stop();
+	g_workers.stop();
+	g_crypto.stop();
+	stop_reactors();
+
+	// running tasks may use the account list, so it's locked only after they finish
+	std::unique_lock<account_list_t> acc_lock(g_accounts);
+
+	g_accounts.save(acc_lock);
+	acc_lock.release(); // leave locked
+
+	ep_printf("EPServer stopped.\n");
+	return 0;
 }
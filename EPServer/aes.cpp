@@ -0,0 +1,208 @@
+#include "stdafx.h"
+#include "cipher.h"
+
+#include <wmmintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+// AES-NI instructions are enabled only for aes_cipher_t (it's created if is_supported() returns true)
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("aes"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("aes")
+#endif
+
+#include "aes.h"
+
+namespace
+{
+	// compute next round key (rcon must be a constant)
+	template<int Rcon> inline __m128i expand_key(__m128i key)
+	{
+		const __m128i t = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(key, Rcon), 0xff);
+
+		key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+		key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+		key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+
+		return _mm_xor_si128(key, t);
+	}
+}
+
+aes_cipher_t::aes_cipher_t(const packet_t& key)
+{
+	if (key->size != 32)
+	{
+		throw std::length_error("Invalid cipher key size");
+	}
+
+	std::memcpy(&m_enc_last, &key->get(16), 16);
+	std::memcpy(&m_dec_last, &key->get(16), 16);
+
+	m_enc[0] = _mm_loadu_si128(static_cast<const __m128i*>(key->data()));
+	m_enc[1] = expand_key<0x01>(m_enc[0]);
+	m_enc[2] = expand_key<0x02>(m_enc[1]);
+	m_enc[3] = expand_key<0x04>(m_enc[2]);
+	m_enc[4] = expand_key<0x08>(m_enc[3]);
+	m_enc[5] = expand_key<0x10>(m_enc[4]);
+	m_enc[6] = expand_key<0x20>(m_enc[5]);
+	m_enc[7] = expand_key<0x40>(m_enc[6]);
+	m_enc[8] = expand_key<0x80>(m_enc[7]);
+	m_enc[9] = expand_key<0x1b>(m_enc[8]);
+	m_enc[10] = expand_key<0x36>(m_enc[9]);
+
+	// equivalent inverse cipher keys
+	m_dec[0] = m_enc[rounds];
+
+	for (u32 i = 1; i < rounds; i++)
+	{
+		m_dec[i] = _mm_aesimc_si128(m_enc[rounds - i]);
+	}
+
+	m_dec[rounds] = m_enc[0];
+}
+
+aes_cipher_t::~aes_cipher_t()
+{
+	for (u32 i = 0; i <= rounds; i++)
+	{
+		m_enc[i] = m_dec[i] = _mm_setzero_si128(); // burn
+	}
+
+	m_enc_last.clear();
+	m_dec_last.clear();
+}
+
+bool aes_cipher_t::is_supported()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+
+	return (info[2] & (1 << 25)) != 0;
+#else
+	unsigned eax, ebx, ecx, edx;
+
+	return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES) != 0;
+#endif
+}
+
+void aes_cipher_t::encrypt_cbc(cipher_block_t* blocks, std::size_t count)
+{
+	__m128i last = m_enc_last.vi;
+
+	for (std::size_t i = 0; i < count; i++)
+	{
+		// CBC initialization
+		__m128i x = _mm_xor_si128(_mm_xor_si128(blocks[i].vi, last), m_enc[0]);
+
+		for (u32 r = 1; r < rounds; r++)
+		{
+			x = _mm_aesenc_si128(x, m_enc[r]);
+		}
+
+		blocks[i].vi = last = _mm_aesenclast_si128(x, m_enc[rounds]);
+	}
+
+	m_enc_last.vi = last;
+}
+
+void aes_cipher_t::decrypt_cbc(cipher_block_t* blocks, std::size_t count)
+{
+	__m128i last = m_dec_last.vi;
+
+	// decrypt independent blocks in parallel (instructions are pipelined)
+	for (; count >= lanes; count -= lanes, blocks += lanes)
+	{
+		__m128i x[lanes];
+
+		for (u32 j = 0; j < lanes; j++)
+		{
+			x[j] = _mm_xor_si128(blocks[j].vi, m_dec[0]);
+		}
+
+		for (u32 r = 1; r < rounds; r++)
+		{
+			for (u32 j = 0; j < lanes; j++)
+			{
+				x[j] = _mm_aesdec_si128(x[j], m_dec[r]);
+			}
+		}
+
+		for (u32 j = 0; j < lanes; j++)
+		{
+			// CBC finalization
+			const __m128i encrypted = blocks[j].vi;
+			blocks[j].vi = _mm_xor_si128(_mm_aesdeclast_si128(x[j], m_dec[rounds]), last);
+			last = encrypted;
+		}
+	}
+
+	for (; count; count--, blocks++)
+	{
+		__m128i x = _mm_xor_si128(blocks->vi, m_dec[0]);
+
+		for (u32 r = 1; r < rounds; r++)
+		{
+			x = _mm_aesdec_si128(x, m_dec[r]);
+		}
+
+		const __m128i encrypted = blocks->vi;
+		blocks->vi = _mm_xor_si128(_mm_aesdeclast_si128(x, m_dec[rounds]), last);
+		last = encrypted;
+	}
+
+	m_dec_last.vi = last;
+}
+
+void aes_cipher_t::make_keystream(cipher_block_t* blocks, std::size_t count, u64 counter, u32 stream) const
+{
+	for (std::size_t i = 0; i < count; i++)
+	{
+		blocks[i].vi = _mm_set_epi32(0, stream, static_cast<u32>((counter + i) >> 32), static_cast<u32>(counter + i));
+	}
+
+	// encrypt counter blocks in parallel (instructions are pipelined)
+	for (; count >= lanes; count -= lanes, blocks += lanes)
+	{
+		__m128i x[lanes];
+
+		for (u32 j = 0; j < lanes; j++)
+		{
+			x[j] = _mm_xor_si128(blocks[j].vi, m_enc[0]);
+		}
+
+		for (u32 r = 1; r < rounds; r++)
+		{
+			for (u32 j = 0; j < lanes; j++)
+			{
+				x[j] = _mm_aesenc_si128(x[j], m_enc[r]);
+			}
+		}
+
+		for (u32 j = 0; j < lanes; j++)
+		{
+			blocks[j].vi = _mm_aesenclast_si128(x[j], m_enc[rounds]);
+		}
+	}
+
+	for (; count; count--, blocks++)
+	{
+		__m128i x = _mm_xor_si128(blocks->vi, m_enc[0]);
+
+		for (u32 r = 1; r < rounds; r++)
+		{
+			x = _mm_aesenc_si128(x, m_enc[r]);
+		}
+
+		blocks->vi = _mm_aesenclast_si128(x, m_enc[rounds]);
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
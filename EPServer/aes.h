@@ -0,0 +1,38 @@
+#pragma once
+
+#include "cipher.h"
+
+// AES-128 implementation using AES-NI instructions
+class aes_cipher_t final : public cipher_t
+{
+	enum : u32
+	{
+		rounds = 10,
+		lanes = 8, // blocks processed in parallel
+	};
+
+	__m128i m_enc[rounds + 1]; // encryption round keys
+	__m128i m_dec[rounds + 1]; // decryption round keys (in reverse order)
+
+	cipher_block_t m_enc_last;
+	cipher_block_t m_dec_last;
+
+public:
+	// key contains 128-bit AES key and initialization vector
+	aes_cipher_t(const packet_t& key);
+	virtual ~aes_cipher_t() override;
+
+	// check AES-NI support
+	static bool is_supported();
+
+	virtual SecureCipherType get_type() const override
+	{
+		return SECURE_AES;
+	}
+
+	virtual void encrypt_cbc(cipher_block_t* blocks, std::size_t count) override;
+
+	virtual void decrypt_cbc(cipher_block_t* blocks, std::size_t count) override;
+
+	virtual void make_keystream(cipher_block_t* blocks, std::size_t count, u64 counter, u32 stream) const override;
+};
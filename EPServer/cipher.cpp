@@ -0,0 +1,42 @@
+#include "stdafx.h"
+#include "cipher.h"
+#include "rc6.h"
+
+void cipher_t::encrypt_cbc_batch(const cipher_job_t* jobs, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; i++)
+	{
+		if (jobs[i].cipher->get_type() != SECURE_RC6)
+		{
+			jobs[i].cipher->encrypt_cbc(jobs[i].blocks, jobs[i].count);
+		}
+	}
+
+	// RC6 jobs are processed in SIMD lanes (other jobs are skipped)
+	rc6_cipher_t::encrypt_cbc_batch(jobs, count);
+}
+
+void cipher_ctr_t::apply(const cipher_t& cipher, void* data, std::size_t size)
+{
+	for (auto ptr = static_cast<u8*>(data); size;)
+	{
+		if (m_pos == m_end)
+		{
+			// generate next keystream batch
+			cipher.make_keystream(m_keys, batch, m_end / 16, m_stream);
+			m_end += sizeof(m_keys);
+		}
+
+		const auto keys = reinterpret_cast<const u8*>(m_keys) + m_pos % sizeof(m_keys);
+		const std::size_t count = std::min<std::size_t>(size, m_end - m_pos);
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			ptr[i] ^= keys[i];
+		}
+
+		m_pos += count;
+		ptr += count;
+		size -= count;
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <emmintrin.h>
+#include "ep_defines.h"
+
+union cipher_block_t
+{
+	u32 i[4];
+	__m128i vi;
+
+	void clear()
+	{
+		vi = _mm_setzero_si128();
+	}
+};
+
+class cipher_t;
+
+// Blocks to encrypt with specified cipher
+struct cipher_job_t
+{
+	cipher_t* cipher;
+	cipher_block_t* blocks;
+	std::size_t count;
+};
+
+// Block cipher interface used by cipher_socket_t
+class cipher_t
+{
+public:
+	virtual ~cipher_t() = default;
+
+	// get cipher identifier
+	virtual SecureCipherType get_type() const = 0;
+
+	virtual void encrypt_cbc(cipher_block_t* blocks, std::size_t count) = 0;
+
+	virtual void decrypt_cbc(cipher_block_t* blocks, std::size_t count) = 0;
+
+	// generate CTR mode keystream blocks starting from specified block counter (stream separates directions)
+	virtual void make_keystream(cipher_block_t* blocks, std::size_t count, u64 counter, u32 stream) const = 0;
+
+	// encrypt blocks of independent ciphers (several ciphers may be processed in parallel)
+	static void encrypt_cbc_batch(const cipher_job_t* jobs, std::size_t count);
+};
+
+// CTR mode state (keystream is generated ahead in batches)
+class cipher_ctr_t final
+{
+	enum : u32
+	{
+		batch = 64, // blocks generated at once
+	};
+
+	cipher_block_t m_keys[batch];
+	u64 m_pos = 0; // stream position
+	u64 m_end = 0; // end of generated keystream
+	const u32 m_stream;
+
+public:
+	cipher_ctr_t(u32 stream)
+		: m_stream(stream)
+	{
+	}
+
+	~cipher_ctr_t()
+	{
+		for (auto& block : m_keys)
+		{
+			block.clear(); // burn
+		}
+	}
+
+	// encrypt or decrypt data
+	void apply(const cipher_t& cipher, void* data, std::size_t size);
+};
@@ -0,0 +1,104 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_acceptor.h"
+
+acceptor_t::acceptor_t(u32 index, std::function<void(socket_id_t, inaddr_t, u16)> handler)
+	: index(index)
+	, handler(std::move(handler))
+{
+}
+
+bool acceptor_t::open(u16 port, bool reuse_port)
+{
+	socket_id_t sid = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (sid == INVALID_SOCKET)
+	{
+		fmt::print("socket() failed: {:#x}\n", GETERROR);
+		return false;
+	}
+
+	m_socket.reset(sid);
+
+	if (reuse_port)
+	{
+#ifdef SO_REUSEPORT
+		const int value = 1;
+
+		if (setsockopt(sid, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const char*>(&value), sizeof(value)) == SOCKET_ERROR)
+		{
+			fmt::print("setsockopt(SO_REUSEPORT) failed: {:#x}\n", GETERROR);
+			return false;
+		}
+#else
+		fmt::print("SO_REUSEPORT is not supported on this platform.\n");
+		return false;
+#endif
+	}
+
+	sockaddr_in info;
+	info.sin_family = AF_INET;
+	info.sin_addr.s_addr = INADDR_ANY;
+	info.sin_port = htons(port);
+
+	if (bind(sid, reinterpret_cast<sockaddr*>(&info), sizeof(sockaddr_in)) == SOCKET_ERROR)
+	{
+		fmt::print("bind() failed: {:#x}\n", GETERROR);
+		return false;
+	}
+
+	if (listen(sid, SOMAXCONN) == SOCKET_ERROR)
+	{
+		fmt::print("listen() failed: {:#x}\n", GETERROR);
+		return false;
+	}
+
+	return true;
+}
+
+void acceptor_t::run()
+{
+	while (true)
+	{
+		// accept connection
+		sockaddr_in info;
+		socklen_t size = sizeof(sockaddr_in);
+		socket_id_t aid = accept(m_socket.get_id(), reinterpret_cast<sockaddr*>(&info), &size);
+
+		if (aid == INVALID_SOCKET)
+		{
+			if (m_closed.load())
+			{
+				return;
+			}
+
+			// temporary failure (for example, too many open files)
+			m_failed++;
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			continue;
+		}
+
+		m_accepted++;
+
+		// connection is logged by the handler (printing is too slow for the accept loop)
+		handler(aid, info.sin_addr, info.sin_port);
+	}
+}
+
+void acceptor_t::close()
+{
+	if (m_closed.exchange(true))
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	m_socket.close(); // wake up accept() in other thread
+#else
+	shutdown(m_socket.get_id(), SHUT_RDWR); // wake up accept() in other thread, the descriptor is closed by the destructor
+#endif
+}
+
+void acceptor_t::append_info(std::string& info) const
+{
+	info += fmt::format("\nAcceptor {}: {} accepted, {} failed", index, m_accepted.load(), m_failed.load());
+}
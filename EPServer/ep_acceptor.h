@@ -0,0 +1,32 @@
+#pragma once
+#include "ep_defines.h"
+#include "ep_socket.h"
+
+// Listening socket with its accept loop (several acceptors may share the port with SO_REUSEPORT)
+class acceptor_t final
+{
+	socket_t m_socket;
+	std::atomic<bool> m_closed{ false }; // set by close(), the socket is only shut down to avoid descriptor reuse
+
+	std::atomic<u64> m_accepted{ 0 }; // accepted connections
+	std::atomic<u64> m_failed{ 0 }; // accept() errors
+
+public:
+	const u32 index;
+
+	// accepted connection handler (the worker of this acceptor)
+	const std::function<void(socket_id_t, inaddr_t, u16)> handler;
+
+	acceptor_t(u32 index, std::function<void(socket_id_t, inaddr_t, u16)> handler);
+
+	// create listening socket
+	bool open(u16 port, bool reuse_port);
+
+	// accept connections until the socket is closed
+	void run();
+
+	// stop accept loop (thread-safe)
+	void close();
+
+	void append_info(std::string& info) const;
+};
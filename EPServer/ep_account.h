@@ -1,5 +1,6 @@
 #pragma once
 #include "ep_defines.h"
+#include "ep_flood.h"
 
 class account_list_t;
 
@@ -14,6 +15,8 @@ public:
 	short_str_t<48> uniq_name;
 	short_str_t<255> email;
 
+	flood_control_t flood; // not saved
+
 	void save(std::FILE* f);
 	bool load(std::FILE* f);
 
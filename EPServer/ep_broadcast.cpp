@@ -0,0 +1,99 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_broadcast.h"
+
+static_assert((broadcast_ring_t::capacity & (broadcast_ring_t::capacity - 1)) == 0, "Invalid broadcast ring capacity");
+
+broadcast_ring_t g_broadcast;
+
+void broadcast_ring_t::publish(packet_t packet, filter_t filter)
+{
+	const u64 seq = m_claim.fetch_add(1);
+
+	auto& slot = m_slots[seq % capacity];
+
+	// wait for the producer of the previous lap (only possible if it has been preempted)
+	while (seq >= capacity && slot.stamp.load() < 2 * (seq - capacity) + 2)
+	{
+		std::this_thread::yield();
+	}
+
+	slot.stamp.store(2 * seq + 1);
+
+	// wait for consumers copying the old entry (they check the stamp after registering)
+	while (slot.readers.load())
+	{
+		std::this_thread::yield();
+	}
+
+	slot.packet = std::move(packet);
+	slot.filter = filter;
+	slot.stamp.store(2 * seq + 2);
+
+	// advance published position over completed entries (the producer of an earlier entry continues if it's still writing)
+	u64 pos = m_published.load();
+
+	while (m_slots[pos % capacity].stamp.load() >= 2 * pos + 2)
+	{
+		if (m_published.compare_exchange_weak(pos, pos + 1))
+		{
+			pos++;
+		}
+	}
+
+	rcu_guard_t guard;
+
+	for (const auto& subscriber : m_subscribers.get())
+	{
+		subscriber.second();
+	}
+}
+
+broadcast_state_t broadcast_ring_t::read(u64 seq, packet_t& packet, filter_t& filter)
+{
+	auto& slot = m_slots[seq % capacity];
+
+	slot.readers.fetch_add(1);
+
+	const u64 stamp = slot.stamp.load();
+
+	if (stamp == 2 * seq + 2)
+	{
+		packet = slot.packet;
+		filter = slot.filter;
+	}
+
+	slot.readers.fetch_sub(1);
+
+	return stamp == 2 * seq + 2 ? BS_READY : stamp > 2 * seq + 2 ? BS_LAPPED : BS_EMPTY;
+}
+
+u64 broadcast_ring_t::subscribe(std::function<void()> callback)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto list = m_subscribers.get();
+	list.emplace_back(++m_last_subscriber, std::move(callback));
+	m_subscribers.publish(std::move(list));
+
+	return m_last_subscriber;
+}
+
+void broadcast_ring_t::unsubscribe(u64 id)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto list = m_subscribers.get();
+
+		list.erase(std::remove_if(list.begin(), list.end(), [id](const std::pair<u64, std::function<void()>>& subscriber)
+		{
+			return subscriber.first == id;
+		}), list.end());
+
+		m_subscribers.publish(std::move(list));
+	}
+
+	// publishers may still call it from the old list
+	rcu_synchronize();
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "ep_defines.h"
+#include "ep_rcu.h"
+
+class player_t;
+
+enum broadcast_state_t
+{
+	BS_EMPTY, // entry isn't published yet
+	BS_READY,
+	BS_LAPPED, // entry has been overwritten
+};
+
+// Global ring of broadcast packets: producers append each packet once, every listener reads it with its own cursor
+class broadcast_ring_t final
+{
+public:
+	using filter_t = bool(*)(player_t&);
+
+	enum : u32
+	{
+		capacity = 4096, // max unread entries per listener (must be a power of two)
+	};
+
+private:
+	struct alignas(64) slot_t
+	{
+		std::atomic<u64> stamp{ 0 }; // 2 * seq + 1 while writing, 2 * seq + 2 when published
+		std::atomic<u32> readers{ 0 }; // consumers copying the entry
+		packet_t packet;
+		filter_t filter = nullptr;
+	};
+
+	std::array<slot_t, capacity> m_slots; // the ring is a global object (keeps slot alignment)
+	alignas(64) std::atomic<u64> m_claim{ 0 }; // next sequence number
+	alignas(64) std::atomic<u64> m_published{ 0 }; // all entries before it are published (advanced after the stamp is written)
+
+	std::mutex m_mutex; // serializes subscriber list updates
+	rcu_ptr_t<std::vector<std::pair<u64, std::function<void()>>>> m_subscribers;
+	u64 m_last_subscriber = 0; // protected by m_mutex
+
+public:
+	// append packet (filter is evaluated by consumers for their players, nullptr means all players)
+	void publish(packet_t packet, filter_t filter = nullptr);
+
+	// copy entry with specified sequence number
+	broadcast_state_t read(u64 seq, packet_t& packet, filter_t& filter);
+
+	// get sequence number of the next entry
+	u64 position() const
+	{
+		return m_claim.load();
+	}
+
+	// get sequence number of the first entry which may be unpublished
+	u64 published() const
+	{
+		return m_published.load();
+	}
+
+	// register callback called after every publish (must be fast and thread-safe), return subscription id
+	u64 subscribe(std::function<void()> callback);
+
+	// remove callback, it's not running or called anymore when the function returns
+	void unsubscribe(u64 id);
+};
+
+extern broadcast_ring_t g_broadcast;
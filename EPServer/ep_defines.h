@@ -169,6 +169,12 @@ public:
 		return m_ptr;
 	}
 
+	// check whether the packet isn't shared
+	bool unique() const
+	{
+		return m_ptr && m_ptr->m_refcnt == 1;
+	}
+
 	explicit operator bool() const
 	{
 		return m_ptr != nullptr;
@@ -304,6 +310,26 @@ enum ProtocolCmdType : u8
 
 	CLIENT_SECURE_AUTH = 19,
 	SERVER_NONFATALDISCONNECT = 20,
+	SERVER_SECURE_MODE = 21, // cipher mode confirmation (the last message encrypted with RC6 in CBC mode)
+	CLIENT_RESUME_AUTH = 22, // session resumption with a ticket (instead of CLIENT_SECURE_AUTH)
+	SERVER_SESSION_TICKET = 23, // resumption ticket (sent after login if requested)
+};
+
+enum SecureModeType : u8
+{
+	SECURE_CBC = 0, // default mode (messages are padded to 16 bytes)
+	SECURE_CTR = 1, // counter mode (no padding)
+};
+
+enum SecureCipherType : u8
+{
+	SECURE_RC6 = 0, // default cipher (session key is used as 256-bit key)
+	SECURE_AES = 1, // AES-128 (session key contains 128-bit key and IV)
+};
+
+enum SecureFlags : u8
+{
+	SECURE_TICKET = 1, // request SERVER_SESSION_TICKET
 };
 
 #pragma pack(push, 1)
@@ -326,6 +352,54 @@ struct SecureAuthRec // doesn't include ProtocolHeader
 	char ckey[32]; // session key
 };
 
+// Optional extension of SecureAuthRec (old clients don't send it and use RC6 in CBC mode).
+// If the server accepts another mode or cipher, it sends SERVER_SECURE_MODE message first,
+// the following data in both directions uses them. The client shouldn't send anything
+// before it receives the first message (so old servers can be detected).
+struct SecureAuthExRec // doesn't include ProtocolHeader
+{
+	enum : u32 { signature = 0x31585045 }; // "EPX1"
+
+	SecureAuthRec auth;
+	u32 sign; // signature
+	u8 modes; // bitmask of supported modes (1 << SecureModeType)
+	u8 ciphers; // bitmask of supported ciphers (1 << SecureCipherType)
+	u8 flags; // SecureFlags
+};
+
+struct SecureModeRec
+{
+	ProtocolHeader header;
+	SecureModeType mode;
+	SecureCipherType cipher;
+};
+
+// Session resumption ticket (the content is opaque for the client)
+struct TicketRec // doesn't include ProtocolHeader
+{
+	u64 id;
+	u8 data[80]; // encrypted content
+	md5_t mac;
+};
+
+// Ticket issued after secure login: the next connection may send CLIENT_RESUME_AUTH instead of
+// CLIENT_SECURE_AUTH (with the same extension data), session key is derived from the secret:
+// md5 HMAC of nonce + 0x01 and md5 HMAC of nonce + 0x02 (secret is the HMAC key).
+// Each ticket can be used once, a new ticket is sent after resumption.
+struct ServerTicketRec
+{
+	ProtocolHeader header;
+	u32 lifetime; // seconds
+	char secret[32]; // resumption secret
+	TicketRec ticket;
+};
+
+struct ClientResumeRec // doesn't include ProtocolHeader
+{
+	TicketRec ticket;
+	char nonce[16]; // random data
+};
+
 struct ServerTextRec
 {
 	enum { max_size = 65527 };
@@ -0,0 +1,81 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_flood.h"
+
+namespace
+{
+	struct flood_budget_t
+	{
+		const char* name;
+		s64 burst; // tokens available after idle time
+		s64 max_debt; // commands are rejected if the debt is greater
+	};
+
+	// sustained rates are defined by command costs (1 ms per token)
+	const flood_budget_t g_budgets[FC_MAX] =
+	{
+		{ "chat", 600, 10000 },
+		{ "email", 0, 10000 },
+		{ "password", 0, 20000 },
+		{ "presence", 300, 10000 },
+		{ "refresh", 0, 10000 },
+	};
+}
+
+std::array<std::atomic<u64>, FC_MAX> flood_control_t::s_rejected{};
+
+flood_control_t::flood_control_t()
+{
+	const u64 now = get_time_ms();
+
+	for (u32 i = 0; i < FC_MAX; i++)
+	{
+		m_tokens[i] = g_budgets[i].burst;
+		m_time[i] = now;
+	}
+}
+
+bool flood_control_t::consume(flood_class_t cls, u32 cost, u32& delay)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// refill bucket
+	const u64 now = get_time_ms();
+	m_tokens[cls] = std::min<s64>(g_budgets[cls].burst, m_tokens[cls] + static_cast<s64>(now - m_time[cls]));
+	m_time[cls] = now;
+
+	if (-m_tokens[cls] > g_budgets[cls].max_debt)
+	{
+		m_rejected[cls]++;
+		s_rejected[cls]++;
+		return false;
+	}
+
+	m_tokens[cls] -= cost;
+
+	// defer next command until the debt is paid
+	delay = std::max<u32>(delay, m_tokens[cls] < 0 ? static_cast<u32>(-m_tokens[cls]) : 0);
+	return true;
+}
+
+void flood_control_t::append_info(std::string& info)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const u64 now = get_time_ms();
+
+	for (u32 i = 0; i < FC_MAX; i++)
+	{
+		const s64 tokens = std::min<s64>(g_budgets[i].burst, m_tokens[i] + static_cast<s64>(now - m_time[i]));
+
+		info += fmt::format("\nFlood ({}): {} ms, {} rejected", g_budgets[i].name, tokens, m_rejected[i]);
+	}
+}
+
+void flood_control_t::append_stats(std::string& info)
+{
+	for (u32 i = 0; i < FC_MAX; i++)
+	{
+		info += fmt::format("\nFlood rejected ({}): {}", g_budgets[i].name, s_rejected[i].load());
+	}
+}
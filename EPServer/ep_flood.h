@@ -0,0 +1,37 @@
+#pragma once
+#include "ep_defines.h"
+
+// Throttled command classes
+enum flood_class_t : u32
+{
+	FC_CHAT, // chat messages and dice
+	FC_EMAIL,
+	FC_PASSWORD,
+	FC_PRESENCE, // hide/show
+	FC_REFRESH, // player list
+
+	FC_MAX
+};
+
+// Token bucket rate limiter (one bucket per command class, 1 token = 1 ms)
+class flood_control_t final
+{
+	std::mutex m_mutex;
+	std::array<s64, FC_MAX> m_tokens; // may be negative (debt)
+	std::array<u64, FC_MAX> m_time; // last update time
+	std::array<u64, FC_MAX> m_rejected{};
+
+	static std::array<std::atomic<u64>, FC_MAX> s_rejected; // total rejection counters
+
+public:
+	flood_control_t();
+
+	// consume cost tokens; set delay (ms) to wait before the next command of this class; return false if the command is rejected
+	bool consume(flood_class_t cls, u32 cost, u32& delay);
+
+	// append bucket state
+	void append_info(std::string& info);
+
+	// append total rejection counters
+	static void append_stats(std::string& info);
+};
@@ -3,6 +3,31 @@
 #include "ep_account.h"
 #include "ep_player.h"
 #include "ep_listener.h"
+#include "ep_broadcast.h"
+
+u32 g_queue_limit = 10000;
+u32 g_queue_size_limit = 4 << 20;
+bool g_queue_resync = false;
+
+std::atomic<u32> listener_t::s_max_count{ 0 };
+std::atomic<u64> listener_t::s_max_size{ 0 };
+std::atomic<u64> listener_t::s_overflows{ 0 };
+std::atomic<u64> listener_t::s_lapped{ 0 };
+
+namespace
+{
+	template<typename T> void update_max(std::atomic<T>& max, T value)
+	{
+		T old = max.load(std::memory_order_relaxed);
+
+		while (old < value && !max.compare_exchange_weak(old, value, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	std::mutex g_parked_mutex;
+	std::atomic<listener_t*> g_parked{ nullptr }; // first consumer waiting in pop_all() (modified under g_parked_mutex, checked without it)
+}
 
 listener_t::listener_t(u32 addr, u16 port, bool enc)
 	: addr(addr)
@@ -13,13 +38,192 @@ listener_t::listener_t(u32 addr, u16 port, bool enc)
 	stop_flag.clear();
 }
 
+listener_t::~listener_t()
+{
+	for (auto node = m_head.exchange(nullptr); node;)
+	{
+		const auto next = node->next;
+		delete node;
+		node = next;
+	}
+}
+
 void listener_t::push_packet(packet_t packet)
 {
-	std::lock_guard<std::mutex> lock(m_mutex);
+	if (packet)
+	{
+		if (m_overflow.load(std::memory_order_relaxed))
+		{
+			return; // the queue will be discarded
+		}
+
+		const u32 count = m_count.fetch_add(1, std::memory_order_relaxed) + 1;
+		const u64 size = m_size.fetch_add(packet->size, std::memory_order_relaxed) + packet->size;
+
+		if ((g_queue_limit && count > g_queue_limit) || (g_queue_size_limit && size > g_queue_size_limit))
+		{
+			m_count.fetch_sub(1, std::memory_order_relaxed);
+			m_size.fetch_sub(packet->size, std::memory_order_relaxed);
+
+			if (!m_overflow.exchange(true))
+			{
+				s_overflows++;
+				wake_up();
+			}
+
+			return;
+		}
+
+		update_max(m_max_count, count);
+		update_max(m_max_size, size);
+		update_max(s_max_count, count);
+		update_max(s_max_size, size);
+	}
+
+	auto head = m_head.load(std::memory_order_relaxed);
+
+	const auto node = new node_t{ head, std::move(packet), g_broadcast.position() };
+
+	// the node belongs to the consumer after it's pushed (it may be already taken and deleted)
+	while (!m_head.compare_exchange_weak(head, node))
+	{
+		node->next = head;
+	}
+
+	// wake up the consumer only if the queue was empty
+	if (!head)
+	{
+		wake_up();
+	}
+}
+
+void listener_t::wake_up()
+{
+	if (m_parked.load())
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_cond.notify_one();
+
+		if (m_signal)
+		{
+			m_signal();
+		}
+	}
+}
+
+void listener_t::wake_up_parked()
+{
+	// a consumer links itself before it checks the ring (it either sees the broadcast or is found here)
+	if (!g_parked.load())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(g_parked_mutex);
+
+	// only linked consumers are visited, woken ones are unlinked (they link again before waiting)
+	for (auto listener = g_parked.load(); listener;)
+	{
+		const auto next = listener->m_next;
+
+		if (listener->m_parked.load())
+		{
+			listener->unlink();
+			listener->wake_up();
+		}
+
+		listener = next;
+	}
+}
+
+void listener_t::link_parked()
+{
+	std::lock_guard<std::mutex> lock(g_parked_mutex);
+
+	const auto first = g_parked.load();
+
+	m_next = first;
+
+	if (first)
+	{
+		first->m_prev = this;
+	}
+
+	g_parked = this;
+	m_linked = true;
+}
+
+void listener_t::unlink_parked()
+{
+	std::lock_guard<std::mutex> lock(g_parked_mutex);
+
+	if (m_linked)
+	{
+		unlink();
+	}
+}
+
+void listener_t::unlink()
+{
+	if (m_prev)
+	{
+		m_prev->m_next = m_next;
+	}
+	else
+	{
+		g_parked = m_next;
+	}
+
+	if (m_next)
+	{
+		m_next->m_prev = m_prev;
+	}
+
+	m_linked = false;
+	m_prev = nullptr;
+	m_next = nullptr;
+}
+
+void listener_t::attach(player_t* player)
+{
+	m_cursor = g_broadcast.position();
+	m_player = player;
+}
+
+bool listener_t::take_broadcast(std::vector<packet_t>& packets, u64 end)
+{
+	const auto player = m_player.load();
+
+	if (!player)
+	{
+		return true;
+	}
+
+	for (; m_cursor < end; m_cursor++)
+	{
+		packet_t packet;
+		broadcast_ring_t::filter_t filter;
 
-	m_queue.emplace(std::move(packet));
+		switch (g_broadcast.read(m_cursor, packet, filter))
+		{
+		case BS_EMPTY: return true;
+		case BS_LAPPED: return false;
+		case BS_READY: break;
+		}
 
-	m_cond.notify_one();
+		if (!filter || filter(*player))
+		{
+			packets.emplace_back(std::move(packet));
+		}
+	}
+
+	return true;
+}
+
+bool listener_t::has_broadcast() const
+{
+	return m_player.load() && g_broadcast.published() > m_cursor;
 }
 
 void listener_t::push(const void* data, u32 size)
@@ -31,21 +235,148 @@ void listener_t::push(const void* data, u32 size)
 	push_packet(std::move(packet));
 }
 
-packet_t listener_t::pop(u32 timeout_ms, const packet_t& default_packet)
+void listener_t::take(std::vector<packet_t>& packets)
+{
+	node_t* list = nullptr;
+
+	// reverse the stack
+	for (auto node = m_head.exchange(nullptr, std::memory_order_acquire); node;)
+	{
+		const auto next = node->next;
+		node->next = list;
+		list = node;
+		node = next;
+	}
+
+	bool overflow = m_overflow.load();
+
+	u32 count = 0;
+	u64 size = 0;
+
+	while (list)
+	{
+		// broadcast packets published before the private one go first
+		if (!overflow && !take_broadcast(packets, list->seq))
+		{
+			overflow = true;
+			m_overflow = true;
+			s_lapped++;
+		}
+
+		if (list->packet)
+		{
+			count++;
+			size += list->packet->size;
+		}
+
+		if (!overflow || !list->packet)
+		{
+			packets.emplace_back(std::move(list->packet));
+		}
+
+		const auto next = list->next;
+		delete list;
+		list = next;
+	}
+
+	m_count.fetch_sub(count, std::memory_order_relaxed);
+	m_size.fetch_sub(size, std::memory_order_relaxed);
+
+	if (!overflow && !take_broadcast(packets, UINT64_MAX))
+	{
+		overflow = true;
+		m_overflow = true;
+		s_lapped++;
+	}
+
+	if (overflow)
+	{
+		if (g_queue_resync && m_resync)
+		{
+			// queued packets are lost, send actual player list
+			m_overflow = false;
+			m_cursor = g_broadcast.position();
+			packets.emplace_back(ServerTextRec::make(GetTime(), "Some messages were lost due to slow connection."));
+			packets.emplace_back(m_resync());
+		}
+		else
+		{
+			packets.emplace_back(nullptr); // disconnect
+		}
+	}
+}
+
+void listener_t::pop_all(std::vector<packet_t>& packets)
 {
-	std::unique_lock<std::mutex> lock(m_mutex);
+	// parked consumers must be woken up after broadcast (registered once)
+	static std::once_flag subscribed;
 
-	m_cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&]
+	std::call_once(subscribed, []()
 	{
-		return !m_queue.empty();
+		g_broadcast.subscribe(&listener_t::wake_up_parked);
 	});
 
-	if (m_queue.empty())
+	while (true)
 	{
-		return default_packet;
+		take(packets);
+
+		if (!packets.empty())
+		{
+			return;
+		}
+
+		// broadcast producers wake up and unlink the consumer (the list is locked before m_mutex)
+		link_parked();
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			// producers check m_parked after pushing or publishing
+			m_parked = true;
+
+			// wait once: a woken consumer may be unlinked, so it checks the queue and links again
+			if (!m_head.load() && !m_overflow.load() && !has_broadcast())
+			{
+				m_cond.wait(lock);
+			}
+
+			m_parked = false;
+		}
+
+		unlink_parked();
 	}
+}
 
-	packet_t packet = std::move(m_queue.front());
-	m_queue.pop();
-	return packet;
+bool listener_t::try_pop_all(std::vector<packet_t>& packets)
+{
+	const auto old_size = packets.size();
+
+	take(packets);
+
+	return packets.size() != old_size;
+}
+
+void listener_t::set_signal(std::function<void()> signal)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// the reactor must be signaled every time the queue becomes non-empty
+	m_parked = signal != nullptr;
+	m_signal = std::move(signal);
+}
+
+void listener_t::set_resync(std::function<packet_t()> resync)
+{
+	m_resync = std::move(resync);
+}
+
+void listener_t::append_info(std::string& info)
+{
+	info += fmt::format(" [queue: {}/{} bytes, max {}/{} bytes]", m_count.load(), m_size.load(), m_max_count.load(), m_max_size.load());
+}
+
+void listener_t::append_stats(std::string& info)
+{
+	info += fmt::format("\nQueue high-water mark: {} packets, {} bytes, {} overflows", s_max_count.load(), s_max_size.load(), s_overflows.load());
+	info += fmt::format("\nBroadcast ring: {} packets, {} lagging connections", g_broadcast.position(), s_lapped.load());
 }
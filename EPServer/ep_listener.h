@@ -3,11 +3,66 @@
 
 class player_t;
 
+extern u32 g_queue_limit; // max queued packets per connection (0 means unlimited)
+extern u32 g_queue_size_limit; // max queued bytes per connection (0 means unlimited)
+extern bool g_queue_resync; // resend player list on overflow instead of disconnecting
+
 class listener_t final
 {
-	std::mutex m_mutex;
-	std::queue<packet_t> m_queue;
+	struct node_t
+	{
+		node_t* next;
+		packet_t packet;
+		u64 seq; // broadcast ring position at push time
+	};
+
+	std::atomic<node_t*> m_head{ nullptr }; // lock-free LIFO stack of packets, reversed by the consumer
+	std::atomic<bool> m_parked{ false }; // the consumer waits for packets (always set in reactor mode)
+
+	std::mutex m_mutex; // only used to wake up the consumer
 	std::condition_variable m_cond;
+	std::function<void()> m_signal; // called when the queue becomes non-empty (reactor mode)
+	std::function<packet_t()> m_resync; // generates player list after overflow
+
+	std::atomic<u32> m_count{ 0 }; // queued packets
+	std::atomic<u64> m_size{ 0 }; // queued bytes
+	std::atomic<u32> m_max_count{ 0 };
+	std::atomic<u64> m_max_size{ 0 };
+	std::atomic<bool> m_overflow{ false }; // new packets are dropped until the consumer handles it
+
+	std::atomic<player_t*> m_player{ nullptr }; // receives broadcast packets if set
+	u64 m_cursor = 0; // next broadcast ring entry (accessed by the consumer)
+
+	// list of consumers waiting in pop_all(), woken up and unlinked after broadcast (protected by the global mutex)
+	bool m_linked = false;
+	listener_t* m_prev = nullptr;
+	listener_t* m_next = nullptr;
+
+	static std::atomic<u32> s_max_count; // high-water marks of all connections
+	static std::atomic<u64> s_max_size;
+	static std::atomic<u64> s_overflows;
+	static std::atomic<u64> s_lapped; // consumers which fell behind the broadcast ring
+
+	void wake_up();
+
+	// wake up consumers waiting in pop_all() (called after broadcast)
+	static void wake_up_parked();
+
+	// add to or remove from the list of waiting consumers
+	void link_parked();
+	void unlink_parked();
+
+	// remove from the list of waiting consumers (the global mutex must be locked)
+	void unlink();
+
+	// take broadcast packets published before specified position, return false if the ring has been lapped
+	bool take_broadcast(std::vector<packet_t>& packets, u64 end);
+
+	// check whether the broadcast ring has unread entries
+	bool has_broadcast() const;
+
+	// take all packets in FIFO order, handle overflow
+	void take(std::vector<packet_t>& packets);
 
 public:
 	const u32 addr;
@@ -19,6 +74,10 @@ public:
 
 	listener_t(u32 addr, u16 port, bool enc);
 
+	listener_t(const listener_t&) = delete;
+
+	~listener_t();
+
 	void push_packet(packet_t packet);
 
 	void push(const void* data, u32 size);
@@ -33,11 +92,35 @@ public:
 		push_packet(ServerTextRec::make(GetTime(), text));
 	}
 
+	// start receiving broadcast packets (must be called before the consumer starts)
+	void attach(player_t* player);
+
+	// stop receiving broadcast packets
+	void detach()
+	{
+		m_player = nullptr;
+	}
+
 	void stop()
 	{
 		stop_flag.test_and_set();
 		push_packet(nullptr); // use empty message as stop message
 	}
 
-	packet_t pop(u32 timeout_ms, const packet_t& default_packet);
+	// wait for packets and take all of them
+	void pop_all(std::vector<packet_t>& packets);
+
+	// take all packets without waiting, return false if the queue is empty (reactor mode)
+	bool try_pop_all(std::vector<packet_t>& packets);
+
+	void set_signal(std::function<void()> signal);
+
+	// set player list generator (must be called before the consumer starts)
+	void set_resync(std::function<packet_t()> resync);
+
+	// append queue state
+	void append_info(std::string& info);
+
+	// append queue high-water marks
+	static void append_stats(std::string& info);
 };
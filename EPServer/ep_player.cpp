@@ -4,39 +4,80 @@
 #include "ep_account.h"
 #include "ep_player.h"
 #include "ep_listener.h"
+#include "ep_session.h"
+
+namespace
+{
+	std::atomic<u64> g_element_version{ 0 }; // list element versions are global to survive player slot reuse
+}
 
 player_t::player_t(const std::shared_ptr<account_t>& account, u32 index)
 	: account(account)
 	, index(index)
 {
 	account->flags |= PF_LOST; // crutch
-}
 
-void player_t::assign_player_element(PlayerElement& info, const std::unique_lock<account_list_t>& acc_lock)
-{
+	// unique name may be changed concurrently (fixed by refresh_name)
 	if (account->uniq_name.size())
 	{
-		info.name = account->uniq_name;
+		m_element.name = account->uniq_name;
 	}
 	else
 	{
-		info.name = account->name;
+		m_element.name = account->name;
+	}
+
+	m_element.gindex = -1;
+}
+
+u64 player_t::get_element(PlayerElement& info)
+{
+	std::lock_guard<std::mutex> lock(m_element_mutex);
+
+	const u64 flags = account->flags & ~PF_HIDDEN_FLAGS;
+
+	if (!m_version || m_element.flags != flags)
+	{
+		m_element.flags = flags;
+		m_version = ++g_element_version;
 	}
 
-	info.flags = account->flags & ~PF_HIDDEN_FLAGS;
-	info.gindex = -1;
+	info = m_element;
+
+	return m_version;
+}
+
+std::string player_t::get_name()
+{
+	std::lock_guard<std::mutex> lock(m_element_mutex);
+
+	return m_element.name;
+}
+
+void player_t::refresh_name(const std::unique_lock<account_list_t>& acc_lock)
+{
+	const short_str_t<48> name = account->get_name(acc_lock);
+
+	std::lock_guard<std::mutex> lock(m_element_mutex);
+
+	if (!(m_element.name == name))
+	{
+		m_element.name = name;
+		m_version = ++g_element_version;
+	}
 }
 
 void player_t::append_connection_info(std::string& info)
 {
-	std::lock_guard<std::mutex> lock(m_mutex);
+	rcu_guard_t guard;
 
-	for (const auto& listener : m_list)
+	for (const auto& listener : m_list.get())
 	{
 		inaddr_t addr;
 		addr.s_addr = listener->addr;
 
 		info += fmt::format("\nConnection: {}:{}{}", inet_ntoa(addr), listener->port, listener->enc ? " (encrypted)" : "");
+		listener->append_info(info);
 	}
 }
 
@@ -44,28 +85,43 @@ bool player_t::add_listener(std::shared_ptr<listener_t> listener)
 {
 	std::lock_guard<std::mutex> lock(m_mutex);
 
-	if (m_list.size() >= 4) // rough limitation
+	auto list = m_list.get();
+
+	if (list.size() >= 4) // rough limitation
 	{
 		return false;
 	}
 
-	return m_list.emplace_back(std::move(listener)), true;
+	listener->attach(this);
+	list.emplace_back(std::move(listener));
+	update_presence(list);
+	m_list.publish(std::move(list));
+
+	return true;
 }
 
 player_state_t player_t::remove_listener(const std::shared_ptr<listener_t>& listener)
 {
 	std::lock_guard<std::mutex> lock(m_mutex);
 
-	for (auto i = m_list.begin(); i != m_list.end(); i++)
+	auto list = m_list.get();
+
+	for (auto i = list.begin(); i != list.end(); i++)
 	{
 		if (*i == listener)
 		{
-			m_list.erase(i);
+			listener->detach();
+			list.erase(i);
 			break;
 		}
 	}
 
-	if (m_list.size())
+	const bool connected = !list.empty();
+
+	update_presence(list);
+	m_list.publish(std::move(list));
+
+	if (connected)
 	{
 		return PS_CONNECTED;
 	}
@@ -82,20 +138,39 @@ player_state_t player_t::remove_listener(const std::shared_ptr<listener_t>& list
 
 void player_t::broadcast(packet_t packet)
 {
-	std::lock_guard<std::mutex> lock(m_mutex);
+	rcu_guard_t guard;
 
-	for (auto& listener : m_list)
+	for (auto& listener : m_list.get())
 	{
 		listener->push_packet(packet);
 	}
 }
 
+void player_t::update_presence(const listener_list_t& list)
+{
+	const bool online = !list.empty() && (account->flags & PF_OFF) == 0;
+
+	// a disconnected player never touches the index again (its slot may be reused)
+	if (online != m_online)
+	{
+		m_online = online;
+		g_players.set_online(index, online);
+	}
+}
+
+void player_t::update_presence()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	update_presence(m_list.get());
+}
+
 
 std::shared_ptr<player_t> player_list_t::add_player(const std::shared_ptr<account_t>& account)
 {
 	std::lock_guard<std::mutex> lock(m_mutex);
 
-	for (auto& p : m_list)
+	for (auto& p : m_list.get())
 	{
 		if (p && p->account == account)
 		{
@@ -103,68 +178,114 @@ std::shared_ptr<player_t> player_list_t::add_player(const std::shared_ptr<accoun
 		}
 	}
 
+	auto list = m_list.get();
+
 	u32 index = 0;
 
-	for (; index < m_list.size(); index++)
+	while (index < list.size() && list[index])
 	{
-		if (!m_list[index])
-		{
-			return m_list[index] = std::make_shared<player_t>(account, index);
-		}
+		index++;
 	}
 
-	if (m_list.size() == MAX_PLAYERS)
+	if (index == MAX_PLAYERS)
 	{
 		return nullptr;
 	}
 
-	return m_list.emplace_back(std::make_shared<player_t>(account, index)), m_list.back();
+	const auto player = std::make_shared<player_t>(account, index);
+
+	if (index < list.size())
+	{
+		list[index] = player;
+	}
+	else
+	{
+		list.emplace_back(player);
+	}
+
+	m_list.publish(std::move(list));
+
+	return player;
 }
 
 bool player_list_t::remove_player(u32 index)
 {
 	std::lock_guard<std::mutex> lock(m_mutex);
 
-	if (index < m_list.size() && m_list[index])
+	const auto& current = m_list.get();
+
+	if (index < current.size() && current[index])
 	{
-		m_list[index].reset();
+		auto list = current;
+		list[index].reset();
+		m_list.publish(std::move(list));
 		return true;
 	}
 
 	return false;
 }
 
-packet_t player_list_t::generate_player_list(u32 self, const std::unique_lock<account_list_t>& acc_lock)
+bool player_list_t::cache_player(u32 index, const PlayerElement& info, u64 version)
 {
-	std::lock_guard<std::mutex> lock(m_mutex);
+	// updates aren't serialized, the element may have been obtained before a newer one
+	if (version < m_plist_version[index])
+	{
+		return false;
+	}
+
+	// the list grows with the player table and never shrinks
+	while (static_cast<u32>(m_plist.count) <= index)
+	{
+		m_plist.data[m_plist.count++] = { {}, 0, -1 };
+	}
 
-	const u16 hsize = static_cast<u16>(8 + sizeof(PlayerElement) * m_list.size());
+	m_plist.data[index] = info;
+	m_plist_version[index] = version;
+
+	return true;
+}
+
+packet_t player_list_t::make_player_list(u32 self)
+{
+	const u16 hsize = static_cast<u16>(8 + sizeof(PlayerElement) * m_plist.count);
 
 	packet_t packet(hsize + 3);
 
+	std::memcpy(packet->data(), &m_plist, hsize + 3);
+
 	auto& data = packet->get<ServerListRec>();
 	data.header = { SERVER_PLIST, hsize };
 	data.self = self;
-	data.count = static_cast<u32>(m_list.size());
 
-	auto info = data.data;
+	return packet;
+}
 
-	for (auto& player : m_list)
-	{
-		if (player)
-		{
-			player->assign_player_element(*info++, acc_lock);
-		}
-		else
-		{
-			*info++ = { {}, 0, -1 };
-		}
-	}
+packet_t player_list_t::generate_player_list(u32 self)
+{
+	std::lock_guard<std::mutex> lock(m_plist_mutex);
 
-	return packet;
+	return make_player_list(self);
+}
+
+void player_list_t::send_player_list(listener_t& listener, u32 self)
+{
+	std::lock_guard<std::mutex> lock(m_plist_mutex);
+
+	// updates missing in the list are published later
+	listener.push_packet(make_player_list(self));
+}
+
+void player_list_t::refresh_player(const std::shared_ptr<player_t>& player)
+{
+	PlayerElement info;
+	const u64 version = player->get_element(info);
+
+	std::lock_guard<std::mutex> lock(m_plist_mutex);
+
+	cache_player(player->index, info, version);
 }
 
-void player_list_t::update_player(const std::shared_ptr<player_t>& player, const std::unique_lock<account_list_t>& acc_lock, bool removed)
+void player_list_t::update_player(const std::shared_ptr<player_t>& player, bool removed)
 {
 	packet_t packet(sizeof(ServerUpdatePlayer));
 
@@ -173,21 +294,62 @@ void player_list_t::update_player(const std::shared_ptr<player_t>& player, const
 	data.header.size = sizeof(ServerUpdatePlayer) - 3;
 	data.index = player->index;
 
+	u64 version;
+
 	if (removed)
 	{
 		data.data = { {}, 0, -1 };
+		version = ++g_element_version;
 	}
 	else
 	{
-		player->assign_player_element(data.data, acc_lock);
+		version = player->get_element(data.data);
 	}
 
-	broadcast(std::move(packet));
+	std::lock_guard<std::mutex> lock(m_plist_mutex);
+
+	// publish in the same order as the cached list is patched
+	if (cache_player(player->index, data.data, version))
+	{
+		broadcast(std::move(packet));
+	}
 }
 
 std::shared_ptr<player_t> player_list_t::get_player(u32 index)
 {
-	std::lock_guard<std::mutex> lock(m_mutex);
+	rcu_guard_t guard;
+
+	const auto& list = m_list.get();
+
+	return index < list.size() ? list[index] : nullptr;
+}
+
+void player_list_t::set_online(u32 index, bool online)
+{
+	const u64 bit = 1ull << (index % 64);
 
-	return index < m_list.size() ? m_list[index] : nullptr;
+	if (online)
+	{
+		m_online[index / 64].fetch_or(bit);
+		m_online_count++;
+	}
+	else
+	{
+		m_online[index / 64].fetch_and(~bit);
+		m_online_count--;
+	}
+}
+
+void player_list_t::append_stats(std::string& info)
+{
+	rcu_guard_t guard;
+
+	const auto& list = m_list.get();
+
+	info += fmt::format("\nPlayers: {} registered, {} online", list.size() - std::count(list.begin(), list.end(), nullptr), m_online_count.load());
+}
+
+bool only_online(player_t& player)
+{
+	return g_players.is_online(player.index);
 }
@@ -1,5 +1,7 @@
 #pragma once
 #include "ep_defines.h"
+#include "ep_rcu.h"
+#include "ep_broadcast.h"
 
 class account_t;
 class account_list_t;
@@ -14,8 +16,18 @@ enum player_state_t
 
 class player_t final
 {
-	std::mutex m_mutex;
-	std::vector<std::shared_ptr<listener_t>> m_list;
+	using listener_list_t = std::vector<std::shared_ptr<listener_t>>;
+
+	std::mutex m_mutex; // serializes listener list updates
+	rcu_ptr_t<listener_list_t> m_list;
+	bool m_online = false; // state stored in the presence index (protected by m_mutex)
+
+	std::mutex m_element_mutex; // protects cached list element
+	PlayerElement m_element{}; // player list element (name is refreshed by refresh_name, flags are checked on every get)
+	u64 m_version = 0; // element version (changes only if the element changes)
+
+	// update presence index (m_mutex must be locked)
+	void update_presence(const listener_list_t& list);
 
 public:
 	const std::shared_ptr<account_t> account;
@@ -23,7 +35,14 @@ public:
 
 	player_t(const std::shared_ptr<account_t>& account, u32 index);
 
-	void assign_player_element(PlayerElement& info, const std::unique_lock<account_list_t>& acc_lock);
+	// get actual player list element, return its version (doesn't require account lock)
+	u64 get_element(PlayerElement& info);
+
+	// get cached name
+	std::string get_name();
+
+	// update cached name after account name change
+	void refresh_name(const std::unique_lock<account_list_t>& acc_lock);
 
 	void append_connection_info(std::string& info);
 
@@ -37,12 +56,31 @@ public:
 	{
 		broadcast(ServerTextRec::make(GetTime(), text));
 	}
+
+	// update presence index after PF_OFF flag change
+	void update_presence();
 };
 
 class player_list_t final
 {
-	std::mutex m_mutex;
-	std::vector<std::shared_ptr<player_t>> m_list;
+	using player_table_t = std::vector<std::shared_ptr<player_t>>;
+
+	std::mutex m_mutex; // serializes player table updates
+	rcu_ptr_t<player_table_t> m_list; // players by index (readers don't lock)
+
+	std::array<std::atomic<u64>, (MAX_PLAYERS + 63) / 64> m_online{}; // presence index: bitmap of connected players without PF_OFF flag
+	std::atomic<u32> m_online_count{ 0 };
+
+	std::mutex m_plist_mutex; // protects cached player list
+	ServerListRec m_plist{}; // cached SERVER_PLIST packet without self index (patched by update_player)
+
+	std::array<u64, MAX_PLAYERS> m_plist_version{}; // element versions of the cached player list
+
+	// patch cached player list, return false if it contains newer element (m_plist_mutex must be locked)
+	bool cache_player(u32 index, const PlayerElement& info, u64 version);
+
+	// copy cached player list (m_plist_mutex must be locked)
+	packet_t make_player_list(u32 self);
 
 	static bool all_players(player_t&)
 	{
@@ -54,31 +92,43 @@ public:
 
 	bool remove_player(u32 index);
 
-	packet_t generate_player_list(u32 self, const std::unique_lock<account_list_t>& acc_lock);
+	// copy cached player list
+	packet_t generate_player_list(u32 self);
+
+	// push cached player list (ordered with player updates)
+	void send_player_list(listener_t& listener, u32 self);
 
-	void update_player(const std::shared_ptr<player_t>& player, const std::unique_lock<account_list_t>& acc_lock, bool removed = false);
+	// update cached player list without notification
+	void refresh_player(const std::shared_ptr<player_t>& player);
+
+	// update cached player list and notify all players
+	void update_player(const std::shared_ptr<player_t>& player, bool removed = false);
 
 	std::shared_ptr<player_t> get_player(u32 index);
 
-	template<typename T> void broadcast(packet_t packet, const T pred)
+	// set presence index bit (called by player_t)
+	void set_online(u32 index, bool online);
+
+	bool is_online(u32 index) const
 	{
-		std::lock_guard<std::mutex> lock(m_mutex);
-
-		for (auto& player : m_list)
-		{
-			if (player && pred(*player))
-			{
-				player->broadcast(packet);
-			}
-		}
+		return m_online[index / 64].load(std::memory_order_relaxed) >> (index % 64) & 1;
+	}
+
+	// append presence index state
+	void append_stats(std::string& info);
+
+	// send packet to all connected players (appended to the broadcast ring once, pred is evaluated by each connection)
+	void broadcast(packet_t packet, broadcast_ring_t::filter_t pred)
+	{
+		g_broadcast.publish(std::move(packet), pred);
 	}
 
 	void broadcast(packet_t packet)
 	{
-		broadcast(packet, all_players);
+		broadcast(std::move(packet), all_players);
 	}
 
-	template<typename T> void broadcast(const std::string& text, const T pred)
+	void broadcast(const std::string& text, broadcast_ring_t::filter_t pred)
 	{
 		broadcast(ServerTextRec::make(GetTime(), text), pred);
 	}
@@ -88,3 +138,6 @@ public:
 		broadcast(text, all_players);
 	}
 };
+
+// broadcast filter: connected players without PF_OFF flag (checks the presence index)
+bool only_online(player_t& player);
@@ -0,0 +1,158 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_rcu.h"
+
+namespace
+{
+	struct rcu_record_t
+	{
+		std::atomic<u64> epoch{ 0 }; // global epoch seen by the reader (0 if idle)
+		std::atomic<bool> used{ false }; // owned by some thread
+		rcu_record_t* next = nullptr;
+		u32 depth = 0; // nesting level (only accessed by the owner)
+	};
+
+	struct rcu_retired_t
+	{
+		u64 epoch;
+		const void* ptr;
+		void(*deleter)(const void*);
+	};
+
+	std::atomic<rcu_record_t*> g_records{ nullptr }; // reader records are reused after thread exit and never freed
+	std::atomic<u64> g_epoch{ 1 };
+
+	std::mutex g_retired_mutex;
+	std::vector<rcu_retired_t> g_retired; // objects waiting for readers (protected by g_retired_mutex)
+
+	rcu_record_t* acquire_record()
+	{
+		// reuse free record
+		for (auto rec = g_records.load(); rec; rec = rec->next)
+		{
+			if (!rec->used.load(std::memory_order_relaxed) && !rec->used.exchange(true))
+			{
+				return rec;
+			}
+		}
+
+		const auto rec = new rcu_record_t;
+		rec->used = true;
+		rec->next = g_records.load();
+
+		while (!g_records.compare_exchange_weak(rec->next, rec))
+		{
+		}
+
+		return rec;
+	}
+
+	struct rcu_thread_t
+	{
+		rcu_record_t* record = nullptr;
+
+		~rcu_thread_t()
+		{
+			if (record)
+			{
+				record->used.store(false, std::memory_order_release);
+			}
+		}
+
+		rcu_record_t& get()
+		{
+			return record ? *record : *(record = acquire_record());
+		}
+	};
+
+	thread_local rcu_thread_t t_rcu;
+}
+
+rcu_guard_t::rcu_guard_t()
+{
+	auto& rec = t_rcu.get();
+
+	if (rec.depth++ == 0)
+	{
+		rec.epoch.store(g_epoch.load());
+
+		// announce the epoch before loading snapshots
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+}
+
+rcu_guard_t::~rcu_guard_t()
+{
+	auto& rec = t_rcu.get();
+
+	if (--rec.depth == 0)
+	{
+		rec.epoch.store(0, std::memory_order_release);
+	}
+}
+
+void rcu_retire(const void* ptr, void(*deleter)(const void*))
+{
+	// readers which see a newer epoch can't see the object (it's already unlinked)
+	const u64 epoch = g_epoch.fetch_add(1);
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	std::vector<rcu_retired_t> ready;
+
+	{
+		std::lock_guard<std::mutex> lock(g_retired_mutex);
+
+		g_retired.push_back({ epoch, ptr, deleter });
+
+		// find the oldest epoch of active readers
+		u64 oldest = UINT64_MAX;
+
+		for (auto rec = g_records.load(); rec; rec = rec->next)
+		{
+			const u64 seen = rec->epoch.load();
+
+			if (seen && seen < oldest)
+			{
+				oldest = seen;
+			}
+		}
+
+		const auto it = std::partition(g_retired.begin(), g_retired.end(), [oldest](const rcu_retired_t& r)
+		{
+			return r.epoch >= oldest;
+		});
+
+		ready.assign(it, g_retired.end());
+		g_retired.erase(it, g_retired.end());
+	}
+
+	// destroy outside of the lock (deleters may release other objects)
+	for (const auto& r : ready)
+	{
+		r.deleter(r.ptr);
+	}
+}
+
+void rcu_synchronize()
+{
+	// readers which see a newer epoch can't see replaced snapshots
+	const u64 epoch = g_epoch.fetch_add(1);
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	for (auto rec = g_records.load(); rec; rec = rec->next)
+	{
+		while (true)
+		{
+			const u64 seen = rec->epoch.load();
+
+			if (!seen || seen > epoch)
+			{
+				break;
+			}
+
+			std::this_thread::yield();
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "ep_defines.h"
+
+// Read-side critical section: snapshots obtained from rcu_ptr_t stay valid until it ends (never blocks, may be nested)
+class rcu_guard_t final
+{
+public:
+	rcu_guard_t();
+	~rcu_guard_t();
+
+	rcu_guard_t(const rcu_guard_t&) = delete;
+	rcu_guard_t& operator =(const rcu_guard_t&) = delete;
+};
+
+// delete object after all readers which could see it have finished
+void rcu_retire(const void* ptr, void(*deleter)(const void*));
+
+// wait until all readers which could see replaced snapshots have finished (must not be called within rcu_guard_t)
+void rcu_synchronize();
+
+// Pointer to immutable snapshot (readers need rcu_guard_t, writers must be serialized by the owner)
+template<typename T> class rcu_ptr_t final
+{
+	std::atomic<const T*> m_ptr;
+
+	static void destroy(const void* ptr)
+	{
+		delete static_cast<const T*>(ptr);
+	}
+
+public:
+	rcu_ptr_t()
+		: m_ptr(new T())
+	{
+	}
+
+	~rcu_ptr_t()
+	{
+		delete m_ptr.load();
+	}
+
+	rcu_ptr_t(const rcu_ptr_t&) = delete;
+	rcu_ptr_t& operator =(const rcu_ptr_t&) = delete;
+
+	// get current snapshot (valid within rcu_guard_t, or for the writer)
+	const T& get() const
+	{
+		return *m_ptr.load(std::memory_order_acquire);
+	}
+
+	// replace snapshot, the old one is reclaimed when no readers remain
+	void publish(T&& value)
+	{
+		rcu_retire(m_ptr.exchange(new T(std::move(value))), destroy);
+	}
+};
@@ -0,0 +1,1084 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_socket.h"
+#include "ep_listener.h"
+#include "ep_session.h"
+#include "ep_reactor.h"
+#include "ep_uring.h"
+#include "ep_worker.h"
+#include "md5.h"
+#include "ep_broadcast.h"
+
+#ifdef __linux__
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+namespace
+{
+	enum connection_state_t
+	{
+		CS_AUTH_HEADER, // waiting for auth packet header
+		CS_AUTH_DATA, // waiting for auth packet content
+		CS_AUTH_CRYPTO, // waiting for auth packet decryption
+		CS_ONLINE, // processing commands
+		CS_STOPPED, // receiving stopped, sending remaining packets
+		CS_CLOSING, // sending disconnection message
+	};
+
+	const u64 closing_timeout = 5000; // ms
+	const std::size_t max_pending = 0x40000; // stop draining listener queue if too much data isn't sent yet
+	const std::size_t max_input = 0x40000; // stop receiving if too much data isn't processed yet (io_uring)
+
+	enum uring_op_t : u8
+	{
+		UOP_EVENT, // eventfd read
+		UOP_RECV, // multishot receive
+		UOP_SEND,
+		UOP_CANCEL,
+	};
+}
+
+struct reactor_t::connection_t : timer_node_t
+{
+	const u64 id;
+	std::shared_ptr<socket_t> socket;
+	const inaddr_t ip;
+	const u16 port;
+
+	connection_state_t state = CS_AUTH_HEADER;
+	u32 events = 0; // current epoll event mask
+	bool broken = false; // sending failed
+
+	input_buffer_t input; // received data
+
+	ProtocolHeader header{}; // auth packet header
+	std::shared_ptr<session_t> session;
+
+	u64 resume_time = 0; // command processing is delayed until this time (0 if not delayed)
+	bool blocked = false; // command queue is full
+	u64 close_time = 0;
+
+	// io_uring state
+	u32 ops = 0; // operations in flight
+	bool recv_armed = false;
+	bool recv_cancel = false;
+	bool send_armed = false;
+	std::vector<char> sending; // data being sent
+	std::size_t sent = 0;
+	bool deferred = false; // waits for a free submission queue entry
+
+	connection_t(u64 id, std::shared_ptr<socket_t> socket, inaddr_t ip, u16 port)
+		: id(id)
+		, socket(std::move(socket))
+		, ip(ip)
+		, port(port)
+	{
+	}
+};
+
+reactor_t::reactor_t()
+	: m_timers(get_time_ms())
+{
+}
+
+reactor_t::~reactor_t()
+{
+	stop();
+
+	if (m_event != -1)
+	{
+		::close(m_event);
+	}
+
+	if (m_epoll != -1)
+	{
+		::close(m_epoll);
+	}
+}
+
+bool reactor_t::start(bool use_uring)
+{
+	m_event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	if (m_event == -1)
+	{
+		fmt::print("eventfd() failed: {:#x}\n", GETERROR);
+		return false;
+	}
+
+	// all connections may have new broadcast packets
+	m_subscription = g_broadcast.subscribe([this]()
+	{
+		if (!m_broadcast.exchange(true))
+		{
+			wake_up();
+		}
+	});
+
+	if (use_uring)
+	{
+#ifdef HAVE_IO_URING
+		m_uring.reset(new uring_t);
+
+		if (m_uring->init(4096, 1024, 8192))
+		{
+			m_thread = std::thread(&reactor_t::run_uring, this);
+
+			return true;
+		}
+
+		m_uring.reset();
+#endif
+		fmt::print("io_uring is not available, using epoll.\n");
+	}
+
+	m_epoll = epoll_create1(EPOLL_CLOEXEC);
+
+	if (m_epoll == -1)
+	{
+		fmt::print("epoll_create1() failed: {:#x}\n", GETERROR);
+		return false;
+	}
+
+	epoll_event ev{};
+	ev.events = EPOLLIN;
+	ev.data.u64 = 0; // wake-up event
+
+	if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_event, &ev) == -1)
+	{
+		fmt::print("epoll_ctl() failed: {:#x}\n", GETERROR);
+		return false;
+	}
+
+	m_thread = std::thread(&reactor_t::run_epoll, this);
+
+	return true;
+}
+
+void reactor_t::stop()
+{
+	if (m_subscription)
+	{
+		g_broadcast.unsubscribe(m_subscription);
+		m_subscription = 0;
+	}
+
+	if (m_thread.joinable())
+	{
+		m_stop = true;
+		wake_up();
+		m_thread.join();
+
+		// listeners and executors may outlive the reactor (players keep listeners)
+		for (const auto& pair : m_list)
+		{
+			if (pair.second->session)
+			{
+				pair.second->session->listener->set_signal(nullptr);
+				pair.second->session->executor->set_signal(nullptr);
+			}
+		}
+	}
+}
+
+void reactor_t::add(socket_id_t socket, inaddr_t ip, u16 port)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_accepted.empty() && m_signaled.empty() && m_decrypted.empty())
+	{
+		wake_up();
+	}
+
+	m_accepted.emplace_back(socket, ip, port);
+}
+
+void reactor_t::signal(u64 id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_accepted.empty() && m_signaled.empty() && m_decrypted.empty())
+	{
+		wake_up();
+	}
+
+	m_signaled.emplace_back(id);
+}
+
+void reactor_t::on_decrypted(u64 id, packet_t auth_info)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_accepted.empty() && m_signaled.empty() && m_decrypted.empty())
+	{
+		wake_up();
+	}
+
+	m_decrypted.emplace_back(id, std::move(auth_info));
+}
+
+void reactor_t::wake_up()
+{
+	const u64 value = 1;
+
+	if (write(m_event, &value, sizeof(value)) != sizeof(value))
+	{
+		// counter overflow is impossible, ignore
+	}
+}
+
+int reactor_t::get_timeout() const
+{
+	const u64 next = m_timers.next_time();
+
+	if (next == UINT64_MAX)
+	{
+		return -1;
+	}
+
+	const u64 now = get_time_ms();
+
+	return next > now ? static_cast<int>(std::min<u64>(next - now, INT_MAX)) : 0;
+}
+
+void reactor_t::on_wake_up()
+{
+	decltype(m_accepted) accepted;
+	decltype(m_signaled) signaled;
+	decltype(m_decrypted) decrypted;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		accepted.swap(m_accepted);
+		signaled.swap(m_signaled);
+		decrypted.swap(m_decrypted);
+	}
+
+	for (const auto& info : accepted)
+	{
+		open(std::get<0>(info), std::get<1>(info), std::get<2>(info));
+	}
+
+	// hash passwords of decrypted auth packets together
+	std::vector<md5_t> passwords(decrypted.size());
+
+	for (std::size_t i = 0; i < decrypted.size(); i++)
+	{
+		const auto& auth_info = decrypted[i].second;
+
+		if (auth_info && auth_info->size >= sizeof(SecureAuthRec))
+		{
+			passwords[i] = auth_info->get<ClientAuthRec>().pass;
+		}
+	}
+
+	md5_hasher_t::hash_batch(passwords.data(), passwords.data(), passwords.size());
+
+	for (std::size_t i = 0; i < decrypted.size(); i++)
+	{
+		auto& result = decrypted[i];
+		const auto found = m_list.find(result.first);
+
+		// the connection may be closed already
+		if (found != m_list.end() && found->second->state == CS_AUTH_CRYPTO)
+		{
+			login(*found->second, std::move(result.second), &passwords[i]);
+			update(*found->second);
+		}
+	}
+
+	if (m_broadcast.exchange(false))
+	{
+		for (const auto& pair : m_list)
+		{
+			if (pair.second->state == CS_ONLINE)
+			{
+				signaled.emplace_back(pair.first);
+			}
+		}
+	}
+
+	std::sort(signaled.begin(), signaled.end());
+	signaled.erase(std::unique(signaled.begin(), signaled.end()), signaled.end());
+
+	for (const u64 id : signaled)
+	{
+		const auto found = m_list.find(id);
+
+		if (found != m_list.end())
+		{
+			auto& conn = *found->second;
+
+			process_input(conn); // command queue may have free space
+			drain(conn, true);
+
+			cipher_job_t job;
+
+			if (conn.socket->get_staged(job))
+			{
+				m_jobs.emplace_back(job);
+				m_batch.emplace_back(&conn);
+				continue;
+			}
+
+			on_write(conn);
+			update(conn);
+		}
+	}
+
+	// encrypt data of multiple connections at once
+	cipher_t::encrypt_cbc_batch(m_jobs.data(), m_jobs.size());
+
+	for (const auto conn : m_batch)
+	{
+		if (!conn->broken && !conn->socket->put_staged())
+		{
+			conn->broken = true;
+		}
+
+		on_write(*conn);
+		update(*conn);
+	}
+
+	m_jobs.clear();
+	m_batch.clear();
+}
+
+void reactor_t::on_timers()
+{
+	const u64 now = get_time_ms();
+
+	m_timers.advance(now, [&](timer_node_t& node)
+	{
+		auto& conn = static_cast<connection_t&>(node);
+
+		on_timer(conn, now);
+		update(conn);
+	});
+}
+
+void reactor_t::run_epoll()
+{
+	std::array<epoll_event, 256> events;
+
+	while (!m_stop.load())
+	{
+		const int count = epoll_wait(m_epoll, events.data(), static_cast<int>(events.size()), get_timeout());
+
+		if (count == -1)
+		{
+			if (GETERROR == EINTR)
+			{
+				continue;
+			}
+
+			return;
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			const u64 id = events[i].data.u64;
+
+			if (id == 0)
+			{
+				u64 value;
+
+				if (read(m_event, &value, sizeof(value)) != sizeof(value))
+				{
+					// spurious wake-up
+				}
+
+				on_wake_up();
+				continue;
+			}
+
+			const auto found = m_list.find(id);
+
+			if (found == m_list.end())
+			{
+				continue;
+			}
+
+			auto& conn = *found->second;
+
+			if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+			{
+				on_read(conn);
+			}
+
+			if (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+			{
+				on_write(conn);
+			}
+
+			update(conn);
+		}
+
+		on_timers();
+	}
+}
+
+#ifdef HAVE_IO_URING
+
+void reactor_t::run_uring()
+{
+	bool event_armed = false;
+
+	auto read_event = [&]()
+	{
+		if (const auto sqe = m_uring->get_sqe())
+		{
+			sqe->opcode = IORING_OP_READ;
+			sqe->fd = m_event;
+			sqe->addr = reinterpret_cast<u64>(&m_event_value);
+			sqe->len = sizeof(m_event_value);
+			sqe->user_data = UOP_EVENT;
+
+			event_armed = true;
+		}
+	};
+
+	while (!m_stop.load())
+	{
+		if (!event_armed)
+		{
+			read_event();
+		}
+
+		// poll completions while some updates are deferred
+		if (m_uring->submit_and_wait(m_deferred.empty() && event_armed ? get_timeout() : 1) == -1)
+		{
+			fmt::print("io_uring_enter() failed: {:#x}\n", GETERROR);
+			return;
+		}
+
+		m_uring->for_each_cqe([&](const io_uring_cqe& cqe)
+		{
+			if (cqe.user_data == UOP_EVENT)
+			{
+				event_armed = false;
+				read_event();
+				on_wake_up();
+			}
+			else
+			{
+				on_completion(cqe.user_data, cqe.res, cqe.flags);
+			}
+		});
+
+		on_deferred();
+		on_timers();
+	}
+}
+
+void reactor_t::on_completion(u64 user_data, s32 res, u32 flags)
+{
+	const u64 id = user_data >> 8;
+	const auto op = static_cast<uring_op_t>(user_data & 0xff);
+
+	const bool finished = op != UOP_RECV || (flags & IORING_CQE_F_MORE) == 0;
+
+	const auto found = m_list.find(id);
+
+	if (found == m_list.end())
+	{
+		if (flags & IORING_CQE_F_BUFFER)
+		{
+			m_uring->put_buffer(flags >> IORING_CQE_BUFFER_SHIFT);
+		}
+
+		// closed connection
+		const auto closed = m_closed.find(id);
+
+		if (closed != m_closed.end() && finished && !--closed->second->ops)
+		{
+			m_closed.erase(closed);
+		}
+
+		return;
+	}
+
+	auto& conn = *found->second;
+
+	conn.ops -= finished;
+
+	switch (op)
+	{
+	case UOP_RECV:
+	{
+		if (finished)
+		{
+			conn.recv_armed = false;
+			conn.recv_cancel = false;
+		}
+
+		if (flags & IORING_CQE_F_BUFFER)
+		{
+			const u16 bid = flags >> IORING_CQE_BUFFER_SHIFT;
+
+			if (res > 0)
+			{
+				on_data(conn, m_uring->get_buffer(bid), res);
+			}
+
+			m_uring->put_buffer(bid);
+		}
+
+		if (res == 0 || (res < 0 && res != -ENOBUFS && res != -ECANCELED))
+		{
+			on_eof(conn);
+		}
+
+		break;
+	}
+	case UOP_SEND:
+	{
+		conn.send_armed = false;
+
+		if (res < 0)
+		{
+			conn.broken = true;
+		}
+		else
+		{
+			conn.sent += res;
+		}
+
+		on_write(conn);
+		break;
+	}
+	default: break;
+	}
+
+	update(conn);
+}
+
+void reactor_t::update_uring(connection_t& conn)
+{
+	const u64 user_data = conn.id << 8;
+	const int fd = conn.socket->get_id();
+
+	const bool want_recv = conn.state < CS_STOPPED && !conn.blocked && conn.input.size() < max_input;
+
+	if (want_recv && !conn.recv_armed)
+	{
+		if (const auto sqe = m_uring->get_sqe())
+		{
+			sqe->opcode = IORING_OP_RECV;
+			sqe->fd = fd;
+			sqe->ioprio = IORING_RECV_MULTISHOT;
+			sqe->flags = IOSQE_BUFFER_SELECT;
+			sqe->buf_group = uring_t::buffer_group;
+			sqe->user_data = user_data | UOP_RECV;
+
+			conn.recv_armed = true;
+			conn.ops++;
+		}
+		else
+		{
+			defer(conn);
+		}
+	}
+	else if (!want_recv && conn.recv_armed && !conn.recv_cancel)
+	{
+		if (const auto sqe = m_uring->get_sqe())
+		{
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->addr = user_data | UOP_RECV;
+			sqe->user_data = user_data | UOP_CANCEL;
+
+			conn.recv_cancel = true;
+			conn.ops++;
+		}
+		else
+		{
+			defer(conn);
+		}
+	}
+
+	if (!conn.broken && !conn.send_armed && (conn.sent < conn.sending.size() || conn.socket->pending()))
+	{
+		if (conn.sent == conn.sending.size())
+		{
+			// send all data queued since the last send in one request
+			conn.socket->take_pending(conn.sending);
+			conn.sent = 0;
+		}
+
+		if (const auto sqe = m_uring->get_sqe())
+		{
+			sqe->opcode = IORING_OP_SEND;
+			sqe->fd = fd;
+			sqe->addr = reinterpret_cast<u64>(conn.sending.data() + conn.sent);
+			sqe->len = static_cast<u32>(conn.sending.size() - conn.sent);
+			sqe->msg_flags = MSG_NOSIGNAL;
+			sqe->user_data = user_data | UOP_SEND;
+
+			conn.send_armed = true;
+			conn.ops++;
+		}
+		else
+		{
+			// taken data stays in conn.sending
+			defer(conn);
+		}
+	}
+}
+
+void reactor_t::cancel_uring(connection_t& conn)
+{
+	if (const auto sqe = m_uring->get_sqe())
+	{
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->fd = conn.socket->get_id();
+		sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+		sqe->user_data = conn.id << 8 | UOP_CANCEL;
+
+		conn.ops++;
+		conn.deferred = false; // an update deferred before closing isn't needed
+	}
+	else
+	{
+		defer(conn);
+	}
+}
+
+void reactor_t::defer(connection_t& conn)
+{
+	if (!conn.deferred)
+	{
+		conn.deferred = true;
+		m_deferred.emplace_back(conn.id);
+	}
+}
+
+void reactor_t::on_deferred()
+{
+	decltype(m_deferred) deferred;
+	deferred.swap(m_deferred);
+
+	for (const u64 id : deferred)
+	{
+		const auto found = m_list.find(id);
+
+		if (found != m_list.end() && found->second->deferred)
+		{
+			found->second->deferred = false;
+			update(*found->second);
+			continue;
+		}
+
+		// the connection was closed before its cancellation was submitted
+		const auto closed = m_closed.find(id);
+
+		if (closed != m_closed.end() && closed->second->deferred)
+		{
+			closed->second->deferred = false;
+			cancel_uring(*closed->second);
+		}
+	}
+}
+
+#endif
+
+bool reactor_t::use_uring() const
+{
+#ifdef HAVE_IO_URING
+	return m_uring != nullptr;
+#else
+	return false;
+#endif
+}
+
+void reactor_t::open(socket_id_t socket, inaddr_t ip, u16 port)
+{
+	ep_printf_ip("+\n", ip, port);
+
+	std::unique_ptr<connection_t> conn(new connection_t(++m_last_id, std::make_shared<socket_t>(socket), ip, port));
+
+	// send auth packet
+	if (!conn->socket->set_nonblocking(use_uring()) || !conn->socket->put(g_auth_packet->data(), g_auth_packet->size))
+	{
+		ep_printf_ip("- (AUTH-1)\n", ip, port);
+		return;
+	}
+
+	if (!use_uring())
+	{
+		epoll_event ev{};
+		ev.events = conn->events = EPOLLIN;
+		ev.data.u64 = conn->id;
+
+		if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket, &ev) == -1)
+		{
+			ep_printf_ip("- epoll_ctl() failed: {:#x}\n", ip, port, GETERROR);
+			return;
+		}
+	}
+
+	const auto id = conn->id;
+
+	update(*(m_list[id] = std::move(conn)));
+}
+
+void reactor_t::close(connection_t& conn)
+{
+	m_timers.cancel(conn);
+
+	if (conn.session)
+	{
+		conn.session->listener->set_signal(nullptr);
+		conn.session->executor->set_signal(nullptr);
+	}
+
+#ifdef HAVE_IO_URING
+	if (m_uring && conn.ops)
+	{
+		// cancel all operations, the socket will be closed after their completion
+		cancel_uring(conn);
+
+		const auto id = conn.id;
+
+		m_closed[id] = std::move(m_list[id]);
+		m_list.erase(id);
+		return;
+	}
+#endif
+
+	if (!use_uring())
+	{
+		epoll_ctl(m_epoll, EPOLL_CTL_DEL, conn.socket->get_id(), nullptr);
+	}
+
+	m_list.erase(conn.id); // close socket
+}
+
+void reactor_t::update(connection_t& conn)
+{
+	const bool unsent = conn.socket->pending() || conn.sent < conn.sending.size();
+
+	if (conn.state == CS_CLOSING && (conn.broken || !unsent))
+	{
+		return close(conn);
+	}
+
+#ifdef HAVE_IO_URING
+	if (m_uring)
+	{
+		return update_uring(conn);
+	}
+#endif
+
+	u32 events = 0;
+
+	if (conn.state < CS_STOPPED && !conn.resume_time && !conn.blocked)
+	{
+		events |= EPOLLIN;
+	}
+
+	if (!conn.broken && unsent)
+	{
+		events |= EPOLLOUT;
+	}
+
+	if (events != conn.events)
+	{
+		epoll_event ev{};
+		ev.events = conn.events = events;
+		ev.data.u64 = conn.id;
+
+		epoll_ctl(m_epoll, EPOLL_CTL_MOD, conn.socket->get_id(), &ev);
+	}
+}
+
+void reactor_t::set_timer(connection_t& conn, u64 time)
+{
+	// single timer per connection is set to the earliest time
+	if (!conn.is_scheduled() || time < conn.get_time())
+	{
+		m_timers.schedule(conn, time);
+	}
+}
+
+void reactor_t::on_read(connection_t& conn)
+{
+	if (conn.state >= CS_STOPPED)
+	{
+		return;
+	}
+
+	const auto buf = conn.input.reserve(4096);
+	const auto res = conn.socket->receive(buf, conn.input.space());
+
+	if (res > 0)
+	{
+		conn.input.commit(res);
+
+		return process_input(conn);
+	}
+
+	if (res == -1 && WOULDBLOCK(GETERROR))
+	{
+		return;
+	}
+
+	on_eof(conn);
+}
+
+void reactor_t::on_data(connection_t& conn, const void* data, std::size_t size)
+{
+	if (conn.state >= CS_STOPPED)
+	{
+		return;
+	}
+
+	std::memcpy(conn.input.reserve(size), data, size);
+	conn.input.commit(size);
+
+	process_input(conn);
+}
+
+void reactor_t::on_eof(connection_t& conn)
+{
+	// connection closed or failed
+	switch (conn.state)
+	{
+	case CS_AUTH_HEADER:
+	{
+		ep_printf_ip("- (AUTH-1)\n", conn.ip, conn.port);
+		conn.broken = true;
+		conn.state = CS_CLOSING;
+		break;
+	}
+	case CS_AUTH_DATA:
+	case CS_AUTH_CRYPTO:
+	{
+		session_t::login(conn.socket, conn.ip, conn.port, conn.header, nullptr);
+		conn.broken = true;
+		conn.state = CS_CLOSING;
+		break;
+	}
+	case CS_ONLINE:
+	{
+		conn.state = CS_STOPPED;
+		conn.session->finish();
+		break;
+	}
+	default: break;
+	}
+}
+
+void reactor_t::drain(connection_t& conn, bool stage)
+{
+	const u64 now = get_time_ms();
+
+	if (conn.session && conn.state != CS_CLOSING)
+	{
+		// drain listener queue
+		while (conn.state != CS_CLOSING && conn.socket->pending() < max_pending && conn.session->listener->try_pop_all(m_packets))
+		{
+			// empty packet is the stop message
+			const auto stop = std::find_if(m_packets.begin(), m_packets.end(), [](const packet_t& packet)
+			{
+				return !packet;
+			});
+
+			const std::size_t count = stop - m_packets.begin();
+
+			if (!conn.broken && !(stage ? conn.socket->stage_packets(m_packets.data(), count) : conn.socket->put_packets(m_packets.data(), count)))
+			{
+				conn.broken = true;
+			}
+
+			conn.session->send_time = now;
+
+			if (stop != m_packets.end())
+			{
+				// listener stopped
+				conn.session->disconnect(*conn.socket);
+				ep_printf_ip("-\n", conn.ip, conn.port);
+				conn.state = CS_CLOSING;
+				conn.close_time = now + closing_timeout;
+				set_timer(conn, conn.close_time);
+			}
+
+			m_packets.clear();
+		}
+	}
+}
+
+void reactor_t::on_write(connection_t& conn)
+{
+	drain(conn, false);
+
+	if (!use_uring() && !conn.broken && !conn.socket->send_pending())
+	{
+		conn.broken = true;
+	}
+
+	if (conn.broken && conn.state < CS_STOPPED)
+	{
+		if (conn.session)
+		{
+			conn.state = CS_STOPPED;
+			conn.session->listener->stop();
+
+			return on_write(conn);
+		}
+
+		conn.state = CS_CLOSING;
+	}
+}
+
+void reactor_t::on_timer(connection_t& conn, u64 now)
+{
+	if (conn.state == CS_CLOSING)
+	{
+		if (now >= conn.close_time)
+		{
+			conn.broken = true; // give up
+		}
+		else
+		{
+			set_timer(conn, conn.close_time);
+		}
+
+		return;
+	}
+
+	if (conn.resume_time && now >= conn.resume_time)
+	{
+		conn.resume_time = 0;
+		process_input(conn);
+	}
+	else if (conn.resume_time)
+	{
+		set_timer(conn, conn.resume_time);
+	}
+}
+
+void reactor_t::process_input(connection_t& conn)
+{
+	conn.blocked = false;
+
+	while (conn.state < CS_STOPPED && !conn.resume_time)
+	{
+		if (conn.state == CS_AUTH_CRYPTO)
+		{
+			break;
+		}
+
+		if (conn.state == CS_AUTH_HEADER)
+		{
+			if (conn.input.size() < sizeof(ProtocolHeader))
+			{
+				break;
+			}
+
+			std::memcpy(&conn.header, conn.input.data(), sizeof(ProtocolHeader));
+			conn.input.consume(sizeof(ProtocolHeader));
+
+			if (!session_t::check_auth(conn.header))
+			{
+				session_t::login(conn.socket, conn.ip, conn.port, conn.header, nullptr);
+				conn.state = CS_CLOSING;
+				break;
+			}
+
+			conn.state = CS_AUTH_DATA;
+			continue;
+		}
+
+		if (conn.state == CS_AUTH_DATA)
+		{
+			if (conn.input.size() < conn.header.size)
+			{
+				break;
+			}
+
+			packet_t auth_info(conn.input.data(), conn.header.size);
+			conn.input.consume(conn.header.size);
+
+			if (conn.header.code == CLIENT_SECURE_AUTH)
+			{
+				const u64 id = conn.id;
+
+				conn.state = CS_AUTH_CRYPTO;
+
+				// decrypt in the crypto pool (auth is rejected if it's overloaded)
+				if (!session_t::decrypt_auth(std::move(auth_info), [this, id](packet_t data)
+				{
+					on_decrypted(id, std::move(data));
+				}))
+				{
+					login(conn, nullptr);
+				}
+
+				break;
+			}
+
+			login(conn, std::move(auth_info));
+			break;
+		}
+
+		// decode new data and process complete messages
+		ProtocolHeader header;
+		std::size_t size;
+
+		if (!conn.input.get_frame(*conn.socket, header, size))
+		{
+			break;
+		}
+
+		// queue command for execution in the worker pool
+		if (!conn.session->submit(header, conn.input.get_buffer(), conn.input.data() + sizeof(ProtocolHeader), false))
+		{
+			if (conn.session->executor->is_stopped())
+			{
+				conn.state = CS_STOPPED;
+			}
+
+			conn.blocked = true; // wait for free space
+			break;
+		}
+
+		conn.input.consume(size);
+	}
+}
+
+void reactor_t::login(connection_t& conn, packet_t auth_info, const md5_t* pass)
+{
+	// cipher_socket_t created by login() keeps non-blocking or deferred mode
+	conn.session = session_t::login(conn.socket, conn.ip, conn.port, conn.header, std::move(auth_info), pass);
+
+	if (!conn.session)
+	{
+		conn.state = CS_CLOSING;
+		return;
+	}
+
+	const u64 now = get_time_ms();
+	const u64 id = conn.id;
+
+	conn.session->listener->set_signal([this, id]()
+	{
+		signal(id);
+	});
+
+	conn.session->executor->set_signal([this, id]()
+	{
+		signal(id);
+	});
+
+	conn.state = CS_ONLINE;
+
+	// delay command processing like receiver_thread does
+	conn.resume_time = now + 1000;
+	set_timer(conn, conn.resume_time);
+
+	on_write(conn);
+}
+
+#endif
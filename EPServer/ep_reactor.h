@@ -0,0 +1,122 @@
+#pragma once
+#include "ep_defines.h"
+#include "ep_socket.h"
+#include "ep_timer.h"
+
+#ifdef __linux__
+
+class session_t;
+class uring_t;
+
+// Single-threaded event loop which owns non-blocking client sockets (epoll or io_uring backend)
+class reactor_t final
+{
+	struct connection_t;
+
+	int m_epoll = -1;
+	int m_event = -1; // eventfd used to wake up the loop
+
+#ifdef HAVE_IO_URING
+	std::unique_ptr<uring_t> m_uring; // io_uring backend (epoll is used if not set)
+	u64 m_event_value = 0;
+#endif
+
+	std::mutex m_mutex;
+	std::vector<std::tuple<socket_id_t, inaddr_t, u16>> m_accepted; // new sockets (protected by m_mutex)
+	std::vector<u64> m_signaled; // connections with new packets in listener queue (protected by m_mutex)
+	std::vector<std::pair<u64, packet_t>> m_decrypted; // decrypted auth packets (protected by m_mutex)
+	std::atomic<bool> m_broadcast{ false }; // broadcast ring has new entries
+	u64 m_subscription = 0; // broadcast ring subscription (0 if not subscribed)
+
+	std::thread m_thread; // loop thread
+	std::atomic<bool> m_stop{ false }; // the loop exits after wake-up
+
+	// following members are accessed only from the reactor thread
+	std::unordered_map<u64, std::unique_ptr<connection_t>> m_list;
+#ifdef HAVE_IO_URING
+	std::unordered_map<u64, std::unique_ptr<connection_t>> m_closed; // closed connections with pending io_uring operations
+	std::vector<u64> m_deferred; // connections waiting for free submission queue entries
+#endif
+	timer_wheel_t m_timers; // connection timers (closing timeout, etc.)
+	std::vector<packet_t> m_packets; // packets taken from listener queue
+	std::vector<cipher_job_t> m_jobs; // deferred encryption of multiple connections
+	std::vector<connection_t*> m_batch; // connections with deferred encryption
+	u64 m_last_id = 0;
+
+	void run_epoll();
+
+#ifdef HAVE_IO_URING
+	void run_uring();
+
+	void update_uring(connection_t& conn);
+
+	// submit cancellation of all operations of the closed connection
+	void cancel_uring(connection_t& conn);
+
+	// retry the update later if the submission queue is full
+	void defer(connection_t& conn);
+
+	// update deferred connections after completions are processed
+	void on_deferred();
+
+	void on_completion(u64 user_data, s32 res, u32 flags);
+#endif
+
+	bool use_uring() const;
+
+	int get_timeout() const;
+
+	void wake_up();
+
+	void on_wake_up();
+
+	void on_timers();
+
+	void open(socket_id_t socket, inaddr_t ip, u16 port);
+
+	void close(connection_t& conn);
+
+	void update(connection_t& conn);
+
+	void set_timer(connection_t& conn, u64 time);
+
+	void on_read(connection_t& conn);
+
+	void on_data(connection_t& conn, const void* data, std::size_t size);
+
+	void on_eof(connection_t& conn);
+
+	// take packets from listener queue (encryption is deferred if stage is true)
+	void drain(connection_t& conn, bool stage);
+
+	void on_write(connection_t& conn);
+
+	void on_timer(connection_t& conn, u64 now);
+
+	void process_input(connection_t& conn);
+
+	// finish authentication (auth packet must be decrypted)
+	void login(connection_t& conn, packet_t auth_info, const md5_t* pass = nullptr);
+
+	// transfer decrypted auth packet from the crypto pool (thread-safe)
+	void on_decrypted(u64 id, packet_t auth_info);
+
+public:
+	reactor_t();
+
+	~reactor_t();
+
+	// create epoll or io_uring instance and start the loop thread
+	bool start(bool use_uring = false);
+
+	// unsubscribe from broadcast ring and wait for the loop thread (remaining connections are closed by the destructor)
+	void stop();
+
+	// transfer accepted socket to the reactor (thread-safe)
+	void add(socket_id_t socket, inaddr_t ip, u16 port);
+
+	// notify that the connection has new packets (thread-safe)
+	void signal(u64 id);
+};
+
+#endif
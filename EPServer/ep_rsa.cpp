@@ -0,0 +1,58 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_rsa.h"
+
+void rsa_key_t::set(const mpz_class& e, const mpz_class& p, const mpz_class& q)
+{
+	n = p * q;
+
+	// calculate priv key
+	d = (p - 1) * (q - 1);
+	mpz_invert(d.get_mpz_t(), e.get_mpz_t(), d.get_mpz_t());
+
+	// precompute CRT values
+	this->p = p;
+	this->q = q;
+	dp = d % (p - 1);
+	dq = d % (q - 1);
+	mpz_invert(qinv.get_mpz_t(), q.get_mpz_t(), p.get_mpz_t());
+
+	// set rough key size
+	size = static_cast<u32>(mpz_size(d.get_mpz_t()) * sizeof(mp_limb_t));
+}
+
+packet_t rsa_decrypt(const rsa_key_t& key, packet_t data)
+{
+	mpz_class num, m1, m2;
+
+	mpz_import(num.get_mpz_t(), data->size, 1, 1, 1, 0, data->data()); // convert from base 256
+
+	// decrypt using CRT (two half-size exponentiations)
+	mpz_powm(m1.get_mpz_t(), num.get_mpz_t(), key.dp.get_mpz_t(), key.p.get_mpz_t());
+	mpz_powm(m2.get_mpz_t(), num.get_mpz_t(), key.dq.get_mpz_t(), key.q.get_mpz_t());
+	m1 = (m1 - m2) * key.qinv % key.p;
+
+	if (m1 < 0)
+	{
+		m1 += key.p;
+	}
+
+	num = m2 + m1 * key.q;
+
+	// get decrypted data without leading zeros (allocate new block), reject it if it doesn't fit (n may be longer than key size)
+	if (mpz_sizeinbase(num.get_mpz_t(), 256) > data->size)
+	{
+		return nullptr;
+	}
+
+	std::size_t count = 0;
+	mpz_export(&data->get(), &count, 1, 1, 1, 0, num.get_mpz_t());
+
+	if (!count)
+	{
+		data->get<u8>(0) = 0; // nothing is exported for zero
+		count = 1;
+	}
+
+	return { &data->get(), count };
+}
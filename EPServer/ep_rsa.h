@@ -0,0 +1,26 @@
+#pragma once
+#include "ep_defines.h"
+
+#pragma warning(push)
+#pragma warning(disable : 4146 4800)
+#include <mpirxx.h>
+#pragma warning(pop)
+
+// RSA private key with precomputed CRT values
+struct rsa_key_t
+{
+	mpz_class n; // open key
+	mpz_class d; // priv key
+	mpz_class p; // priv key factors
+	mpz_class q;
+	mpz_class dp; // CRT exponents (d mod (p - 1), d mod (q - 1))
+	mpz_class dq;
+	mpz_class qinv; // CRT coefficient (q^-1 mod p)
+	u32 size = 0; // rough key size (bytes)
+
+	// calculate priv key and CRT values from open exponent and priv key factors
+	void set(const mpz_class& e, const mpz_class& p, const mpz_class& q);
+};
+
+// decrypt data (key size, base 256) in place, return it without leading zeros (empty packet if the result doesn't fit)
+packet_t rsa_decrypt(const rsa_key_t& key, packet_t data);
@@ -0,0 +1,1056 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_socket.h"
+#include "ep_account.h"
+#include "ep_player.h"
+#include "ep_listener.h"
+#include "ep_session.h"
+#include "ep_worker.h"
+#include "ep_timer.h"
+#include "md5.h"
+#include "rc6.h"
+#include "aes.h"
+#include "ep_ticket.h"
+#include "ep_rsa.h"
+
+#include "../git-version.inl"
+
+const ServerVersionRec version_info{ SERVER_VERSIONINFO, sizeof(ServerVersionRec) - 3, { EP_VERSION } };
+
+extern rsa_key_t g_key;
+
+u32 g_idle_timeout = 0; // disconnect inactive clients after this time (s), 0 means disabled
+
+namespace
+{
+	const u64 keepalive_interval = 30000; // ms
+
+	// Handshake decryption statistics
+	struct handshake_stats_t
+	{
+		std::mutex mutex;
+		u64 count = 0; // decrypted auth packets
+		u64 wait_total = 0; // total queue wait time (us)
+		u64 wait_max = 0;
+		u64 second = 0; // current second (for the rate)
+		u32 current = 0; // handshakes in the current second
+		u32 last = 0; // handshakes in the previous second
+		std::atomic<u64> rejected{ 0 }; // crypto pool was overloaded
+
+		void add(u64 wait)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			const u64 now = get_time_ms() / 1000;
+
+			if (now != second)
+			{
+				last = now == second + 1 ? current : 0;
+				current = 0;
+				second = now;
+			}
+
+			count++;
+			current++;
+			wait_total += wait;
+			wait_max = std::max(wait_max, wait);
+		}
+
+		std::string format()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			const u64 now = get_time_ms() / 1000;
+			const u32 rate = now == second ? last : now == second + 1 ? current : 0;
+
+			return fmt::format("\nHandshakes: {} ({}/s), {} rejected, queue wait avg {} us, max {} us, {} pending",
+				count, rate, rejected.load(), count ? wait_total / count : 0, wait_max, g_crypto.pending());
+		}
+	};
+
+	handshake_stats_t g_handshakes;
+}
+
+session_t::session_t(const std::shared_ptr<account_t>& account, const std::shared_ptr<player_t>& player, const std::shared_ptr<listener_t>& listener)
+	: account(account)
+	, player(player)
+	, listener(listener)
+	, executor(std::make_shared<serial_executor_t>(64))
+	, send_time(get_time_ms())
+	, activity_time(get_time_ms())
+{
+}
+
+bool session_t::check_auth(const ProtocolHeader& header)
+{
+	return (g_key_size == 0 && header.code == CLIENT_AUTH && header.size == sizeof(ClientAuthRec)) ||
+		(g_key_size != 0 && header.code == CLIENT_SECURE_AUTH && header.size == g_key_size) ||
+		(g_key_size != 0 && header.code == CLIENT_RESUME_AUTH && header.size == sizeof(ClientResumeRec));
+}
+
+bool session_t::decrypt_auth(packet_t auth_info, std::function<void(packet_t)> callback)
+{
+	const auto queued = std::chrono::steady_clock::now();
+
+	const bool posted = g_crypto.try_post([auth_info, callback, queued]() mutable
+	{
+		const auto started = std::chrono::steady_clock::now();
+
+		// auth is rejected if decrypted data doesn't fit
+		auth_info = rsa_decrypt(g_key, std::move(auth_info));
+
+		g_handshakes.add(std::chrono::duration_cast<std::chrono::microseconds>(started - queued).count());
+
+		callback(std::move(auth_info));
+	});
+
+	if (!posted)
+	{
+		g_handshakes.rejected++;
+	}
+
+	return posted;
+}
+
+void session_t::append_stats(std::string& info)
+{
+	info += g_handshakes.format();
+	g_tickets.append_stats(info);
+}
+
+std::shared_ptr<session_t> session_t::login(std::shared_ptr<socket_t>& socket, inaddr_t ip, u16 port, const ProtocolHeader& header, packet_t auth_info, const md5_t* pass)
+{
+	auto message = [](socket_t& socket, const char* text)
+	{
+		const packet_t& packet = ServerTextRec::make(GetTime(), text, strlen(text));
+
+		socket.put(packet->data(), packet->size);
+	};
+
+	std::shared_ptr<account_t> account;
+	packet_t ticket; // copy of secure auth data (if resumption ticket is requested)
+
+	if (header.code == CLIENT_RESUME_AUTH && auth_info && check_auth(header))
+	{
+		// replace ticket with secure auth data (empty if the ticket is rejected)
+		auth_info = g_tickets.redeem(auth_info->get<ClientResumeRec>());
+	}
+
+	{
+		// validate auth packet content
+		if (!check_auth(header) || !auth_info)
+		{
+			ep_printf_ip("- (AUTH-2) ({}, {})\n", ip, port, +header.code, header.size);
+			message(*socket, "Handshake failed.");
+			socket->put(ProtocolHeader{ SERVER_NONFATALDISCONNECT });
+			return nullptr;
+		}
+
+		// select auth mode
+		if (header.code == CLIENT_SECURE_AUTH || header.code == CLIENT_RESUME_AUTH)
+		{
+			if (auth_info->size < sizeof(SecureAuthRec))
+			{
+				// clear invalid data (proceed with empty login)
+				std::memset(auth_info->data(), 0, auth_info->size);
+				pass = nullptr;
+			}
+			else
+			{
+				// re-initialize with encryption
+				const packet_t key{ auth_info->get<SecureAuthRec>().ckey, 32 };
+				const auto cipher = std::make_shared<cipher_socket_t>(*socket, std::unique_ptr<cipher_t>(new rc6_cipher_t(key)));
+
+				socket = cipher;
+
+				// check protocol extension
+				if (auth_info->size >= sizeof(SecureAuthExRec) && auth_info->get<SecureAuthExRec>().sign == SecureAuthExRec::signature)
+				{
+					const auto& ext = auth_info->get<SecureAuthExRec>();
+
+					if (ext.flags & SECURE_TICKET && g_tickets.is_enabled())
+					{
+						ticket = packet_t(&auth_info->get(), sizeof(SecureAuthExRec)); // saved before the password is hashed
+					}
+
+					const bool ctr = (ext.modes & (1 << SECURE_CTR)) != 0;
+					const bool aes = (ext.ciphers & (1 << SECURE_AES)) != 0 && aes_cipher_t::is_supported();
+
+					if (ctr || aes)
+					{
+						socket->put(SecureModeRec{ { SERVER_SECURE_MODE, 2 }, ctr ? SECURE_CTR : SECURE_CBC, aes ? SECURE_AES : SECURE_RC6 });
+						cipher->set_mode(std::unique_ptr<cipher_t>(aes ? new aes_cipher_t(key) : nullptr), ctr);
+					}
+				}
+			}
+		}
+
+		auto& auth = auth_info->get<ClientAuthRec>();
+
+		// check login
+		if (auth.name.size() > 16 || !IsLoginValid(auth.name.data(), auth.name.size()))
+		{
+			ep_printf_ip("- (AUTH-3) ({})\n", ip, port, auth.name.size());
+			message(*socket, "Invalid login.");
+			socket->put(ProtocolHeader{ SERVER_DISCONNECT });
+			return nullptr;
+		}
+
+		// prepare password (calculate md5 from md5(password) arrived)
+		auth.pass = pass && header.code == CLIENT_SECURE_AUTH ? *pass : md5_hasher_t::hash(auth.pass.data(), 16);
+
+		ep_printf_ip("* LOGIN: {}\n", ip, port, auth.name.operator std::string());
+
+		// find or create account
+		if (!(account = g_accounts.add_account(auth.name, auth.pass)))
+		{
+			ep_printf_ip("- (AUTH-4)\n", ip, port);
+			message(*socket, "Invalid password.");
+			socket->put(ProtocolHeader{ SERVER_DISCONNECT });
+			return nullptr;
+		}
+	}
+
+	if (account->flags & PF_NOCONNECT)
+	{
+		ep_printf_ip("- (AUTH-5)\n", ip, port);
+		message(*socket, "Account is banned.");
+		socket->put(ProtocolHeader{ SERVER_DISCONNECT });
+		return nullptr;
+	}
+
+	auto player = g_players.add_player(account);
+
+	if (!player)
+	{
+		ep_printf_ip("- (AUTH-6)\n", ip, port);
+		message(*socket, "Too many players connected.");
+		socket->put(ProtocolHeader{ SERVER_DISCONNECT });
+		return nullptr;
+	}
+
+	auto listener = std::make_shared<listener_t>(ip.s_addr, port, header.code != CLIENT_AUTH);
+
+	const u32 index = player->index;
+
+	listener->set_resync([index]()
+	{
+		return g_players.generate_player_list(index);
+	});
+
+	if (!player->add_listener(listener))
+	{
+		ep_printf_ip("- (AUTH-7)\n", ip, port);
+		message(*socket, "Too many connections.");
+		socket->put(ProtocolHeader{ SERVER_DISCONNECT });
+		return nullptr;
+	}
+
+	// send version information
+	listener->push(version_info);
+
+	listener->push_text("EPServer git version: " GIT_VERSION); // TODO: print greeting and something else
+
+	if (ticket)
+	{
+		const auto& ext = ticket->get<SecureAuthExRec>();
+
+		listener->push_packet(g_tickets.issue(ext.auth.info, ext.modes, ext.ciphers));
+	}
+
+	player->refresh_name(std::unique_lock<account_list_t>(g_accounts));
+
+	// send player list (including own element which may be absent after add_player)
+	g_players.refresh_player(player);
+	g_players.send_player_list(*listener, player->index);
+
+	if (account->flags.fetch_and(~PF_NEW_PLAYER) & PF_NEW_PLAYER) // new player connected
+	{
+		g_players.update_player(player);
+		g_players.broadcast(player->get_name() + "%/ connected as a new player.", only_online);
+		g_accounts.save(std::unique_lock<account_list_t>(g_accounts));
+	}
+	else if (account->flags.fetch_and(~PF_LOST) & PF_LOST) // connection restored
+	{
+		g_players.update_player(player);
+		g_players.broadcast(player->get_name() + "%/ connected.", only_online);
+	}
+	else
+	{
+		g_players.update_player(player); // silent reconnection
+	}
+
+	const auto session = std::make_shared<session_t>(account, player, listener);
+
+	session->start();
+
+	return session;
+}
+
+void session_t::start()
+{
+	const std::weak_ptr<session_t> self = shared_from_this();
+
+	m_timer = std::make_shared<timer_task_t>([self]()
+	{
+		if (const auto session = self.lock())
+		{
+			session->on_timer();
+		}
+	});
+
+	g_timers.schedule(m_timer, get_time_ms() + (g_idle_timeout ? std::min<u64>(keepalive_interval, g_idle_timeout * u64{ 1000 }) : keepalive_interval));
+}
+
+void session_t::on_timer()
+{
+	if (executor->is_stopped())
+	{
+		return; // disconnected
+	}
+
+	const u64 now = get_time_ms();
+
+	if (g_idle_timeout && now >= activity_time + g_idle_timeout * u64{ 1000 })
+	{
+		listener->push_text("Disconnected due to inactivity.");
+		listener->stop();
+		return;
+	}
+
+	u64 next = send_time + keepalive_interval;
+
+	if (now >= next)
+	{
+		listener->push_packet(g_keepalive_packet);
+		next = now + keepalive_interval;
+	}
+
+	if (g_idle_timeout)
+	{
+		next = std::min(next, activity_time + g_idle_timeout * u64{ 1000 });
+	}
+
+	g_timers.schedule(m_timer, next);
+}
+
+void session_t::set_online()
+{
+	const auto flags = account->flags.fetch_and(~PF_OFF);
+
+	if (flags & PF_OFF)
+	{
+		player->update_presence();
+		g_players.update_player(player);
+
+		const auto& text = m_cached_name + "%/ is online.";
+
+		if (~account->flags & PF_SHADOWBAN)
+		{
+			g_players.broadcast(text, only_online);
+		}
+		else
+		{
+			player->broadcast(text);
+		}
+	}
+}
+
+void session_t::set_offline()
+{
+	const auto flags = account->flags.fetch_or(PF_OFF);
+
+	if (~flags & PF_OFF)
+	{
+		player->update_presence();
+		g_players.update_player(player);
+
+		const auto& text = m_cached_name + "%/ is offline.";
+
+		if (~account->flags & PF_SHADOWBAN)
+		{
+			g_players.broadcast(text, only_online);
+		}
+
+		player->broadcast(text);
+	}
+}
+
+bool session_t::submit(const ProtocolHeader& header, packet_t buffer, void* data, bool wait)
+{
+	const auto self = shared_from_this();
+
+	return executor->push([self, header, buffer, data](u32& delay) -> bool
+	{
+		if (!self->execute(header, data, delay))
+		{
+			self->listener->stop();
+			return false;
+		}
+
+		return true;
+	}, wait);
+}
+
+void session_t::finish()
+{
+	const auto listener = this->listener;
+
+	if (!executor->close([listener](u32&) -> bool
+	{
+		listener->stop();
+		return false;
+	}))
+	{
+		listener->stop();
+	}
+}
+
+void session_t::disconnect(socket_t& socket)
+{
+	// discard remaining commands
+	executor->stop();
+	g_timers.cancel(m_timer);
+
+	// detect connection lost
+	if (player->remove_listener(listener) == PS_CONNECTION_LOST)
+	{
+		// check if the quit command has been sent
+		if (listener->quit_flag.test_and_set())
+		{
+			g_players.broadcast(player->get_name() + "%/ has quit.", only_online);
+			g_players.update_player(player, true);
+			g_players.remove_player(player->index);
+		}
+		else
+		{
+			g_players.update_player(player);
+			g_players.broadcast(player->get_name() + "%/ lost connection with server.", only_online);
+		}
+	}
+
+	// close connection
+	socket.put(ProtocolHeader{ listener->stop_flag.test_and_set() ? SERVER_DISCONNECT : SERVER_NONFATALDISCONNECT });
+}
+
+bool session_t::throttle(flood_class_t cls, u32 cost, u32& delay)
+{
+	if (!account->flood.consume(cls, cost, delay))
+	{
+		listener->push_text("You are sending commands too fast.");
+		return false;
+	}
+
+	return true;
+}
+
+bool session_t::execute(const ProtocolHeader& header, void* data, u32& delay)
+{
+	auto& cmd = *static_cast<ClientCmdRec*>(data);
+
+	activity_time = get_time_ms();
+
+	// Update cached name
+	if (!(account->uniq_name.size() != 0 && account->uniq_name == m_cached_name) && !(account->name == m_cached_name))
+	{
+		m_cached_name = account->get_name(std::unique_lock<account_list_t>(g_accounts));
+	}
+
+	if (header.code == CLIENT_CMD && header.size >= 14)
+	{
+		const u16 text_size = header.size - 14;
+
+		switch (cmd.cmd)
+		{
+		case CMD_NONE: break;
+
+		case CMD_CHAT:
+		{
+			const std::string message(cmd.data, text_size);
+
+			if (message.find("%p") != std::string::npos)
+			{
+				listener->push_text("You cannot send %%p marker.");
+				listener->push_text(message);
+			}
+			else if (message.find("%/") != std::string::npos)
+			{
+				listener->push_text("You cannot send %%/ marker.");
+				listener->push_text(message);
+			}
+			else if (cmd.v0 == -1 && !cmd.v1 && !cmd.v2)
+			{
+				// public message (~207 ms + 1 ms per character)
+				if (!throttle(FC_CHAT, 200 + header.size, delay))
+				{
+					listener->push_text(message);
+				}
+				else if (account->flags & PF_NOCHAT)
+				{
+					listener->push_text("You cannot write public messages.");
+					listener->push_text(message);
+				}
+				else
+				{
+					set_online();
+
+					const auto& text = message.substr(0, 4) == "/me " || message.substr(0, 4) == u8"/я "
+						? m_cached_name + "%/ " + message.substr(4)
+						: m_cached_name + "%/ %bwrites:%x " + message;
+
+					if (~account->flags & PF_SHADOWBAN)
+					{
+						g_players.broadcast(text, only_online);
+					}
+					else
+					{
+						player->broadcast(text);
+					}
+				}
+			}
+			else if (cmd.v0 >= 0 && !cmd.v1 && !cmd.v2)
+			{
+				// private message (~201 ms + 0.25 ms per character)
+				if (!throttle(FC_CHAT, 200 + header.size / 4, delay))
+				{
+					listener->push_text(message);
+				}
+				else if (account->flags & PF_NOPRIVCHAT)
+				{
+					listener->push_text("You cannot write private messages.");
+					listener->push_text(message);
+				}
+				else if (const auto target = g_players.get_player(cmd.v0))
+				{
+					if (~account->flags & PF_SHADOWBAN || player == target)
+					{
+						target->broadcast(m_cached_name + "%/%p%g writes (private):%x " + message);
+					}
+				}
+				else
+				{
+					listener->push_text("Invalid player.");
+				}
+			}
+			else
+			{
+				listener->push_text("Invalid arguments.");
+			}
+			break;
+		}
+		case CMD_DICE:
+		{
+			if (cmd.v0 == -1 && !cmd.v2)
+			{
+				// public dice (200 ms)
+				if (!throttle(FC_CHAT, 200, delay))
+				{
+					break;
+				}
+
+				if (account->flags & PF_NOCHAT)
+				{
+					listener->push_text("You cannot write public messages.");
+				}
+				else
+				{
+					set_online();
+
+					const auto& text = m_cached_name + "%/ throws " + FormatDice(cmd.v1);
+
+					if (~account->flags & PF_SHADOWBAN)
+					{
+						g_players.broadcast(text, only_online);
+					}
+					else
+					{
+						player->broadcast(text);
+					}
+				}
+			}
+			else if ((cmd.v0 == -2 || cmd.v0 == player->index) && !cmd.v2)
+			{
+				// self dice
+				listener->push_text("You throw " + FormatDice(cmd.v1));
+			}
+			else if (cmd.v0 >= 0 && !cmd.v2)
+			{
+				// private dice (200 ms)
+				if (!throttle(FC_CHAT, 200, delay))
+				{
+					break;
+				}
+
+				if (account->flags & PF_NOPRIVCHAT)
+				{
+					listener->push_text("You cannot write private messages.");
+				}
+				else if (const auto target = g_players.get_player(cmd.v0))
+				{
+					const std::string& dice = FormatDice(cmd.v1);
+
+					if (~account->flags & PF_SHADOWBAN)
+					{
+						target->broadcast(m_cached_name + "%/%p throws " + dice + " to you (private)");
+					}
+
+					listener->push_text("You throw " + dice + "%/ to " + target->account->get_name(std::unique_lock<account_list_t>(g_accounts)));
+				}
+				else
+				{
+					listener->push_text("Invalid player.");
+				}
+			}
+			else
+			{
+				listener->push_text("Invalid arguments.");
+			}
+			break;
+		}
+		case CMD_SHOUT:
+		{
+			if (account->flags & PF_SUPERADMIN)
+			{
+				g_players.broadcast(m_cached_name + "%/ %bwrites:%x " + std::string(cmd.data, text_size));
+			}
+			else
+			{
+				listener->push_text("Check your privilege.");
+			}
+			break;
+		}
+		case CMD_SET_EMAIL:
+		{
+			if (cmd.v0 == -1 && !cmd.v1 && !cmd.v2)
+			{
+				// 1 s
+				if (!throttle(FC_EMAIL, 1000, delay))
+				{
+					break;
+				}
+
+				{
+					std::unique_lock<account_list_t> acc_lock(g_accounts);
+
+					account->email = { cmd.data, text_size };
+
+					g_accounts.save(acc_lock);
+				}
+
+				listener->push_text("E-mail set:");
+				listener->push_text({ cmd.data, std::min<u16>(255, text_size) });
+			}
+			else if (!cmd.v1 && !cmd.v2)
+			{
+				if (account->flags & PF_SUPERADMIN)
+				{
+					// find cmd.v0 player and set email
+					if (const auto target = g_players.get_player(cmd.v0))
+					{
+						{
+							std::unique_lock<account_list_t> acc_lock(g_accounts);
+
+							target->account->email = { cmd.data, text_size };
+
+							g_accounts.save(acc_lock);
+						}
+
+						listener->push_text("E-mail set:"); // TODO (message)
+						listener->push_text({ cmd.data, std::min<u16>(255, text_size) });
+					}
+					else
+					{
+						listener->push_text("Invalid player.");
+					}
+				}
+				else
+				{
+					listener->push_text("Check your privilege.");
+				}
+			}
+			else
+			{
+				listener->push_text("Invalid arguments.");
+			}
+			break;
+		}
+		case CMD_SET_PASSWORD:
+		{
+			if (cmd.v0 == -1 && !cmd.v1 && !cmd.v2 && text_size > 16)
+			{
+				// 4 s
+				if (!throttle(FC_PASSWORD, 4000, delay))
+				{
+					break;
+				}
+
+				// check old password and set new one
+				md5_t old;
+
+				// calculate md5(md5(password))
+				old = md5_hasher_t::hash(cmd.data + 16, text_size - 16);
+				old = md5_hasher_t::hash(old.data(), 16);
+
+				if (old == account->pass)
+				{
+					{
+						std::unique_lock<account_list_t> acc_lock(g_accounts);
+
+						account->pass = *reinterpret_cast<md5_t*>(cmd.data);
+
+						g_accounts.save(acc_lock);
+					}
+
+					listener->push_text("Password updated.");
+				}
+				else
+				{
+					listener->push_text("Invalid password.");
+				}
+
+				std::memset(cmd.data, 0, text_size);
+			}
+			else if (!cmd.v1 && !cmd.v2 && text_size == 16)
+			{
+				if (account->flags & PF_SUPERADMIN)
+				{
+					// find cmd.v0 player and reset password
+					if (const auto target = g_players.get_player(cmd.v0))
+					{
+						{
+							std::unique_lock<account_list_t> acc_lock(g_accounts);
+
+							target->account->pass = *reinterpret_cast<md5_t*>(cmd.data);
+
+							g_accounts.save(acc_lock);
+						}
+
+						listener->push_text("Password updated."); // TODO (message)
+					}
+					else
+					{
+						listener->push_text("Invalid player.");
+					}						
+				}
+				else
+				{
+					listener->push_text("Check your privilege.");
+				}
+			}
+			else
+			{
+				listener->push_text("Invalid arguments.");
+			}
+			break;
+		}
+		case CMD_SET_FLAG:
+		{
+			if (account->flags & PF_SUPERADMIN)
+			{
+				const u64 flag = 1ull << cmd.v1;
+
+				if (cmd.v1 < 64u && flag != PF_SUPERADMIN && !cmd.v2)
+				{
+					// find cmd.v0 player and change flag
+					if (const auto target = g_players.get_player(cmd.v0))
+					{
+						std::unique_lock<account_list_t> acc_lock(g_accounts);
+
+						// TODO (message)
+
+						const u64 _flags = target->account->flags ^= flag;
+
+						target->update_presence();
+
+						if ((flag & PF_HIDDEN_FLAGS) == 0)
+						{
+							target->broadcast("Flag [" + std::string(FlagName[cmd.v1]) + (_flags & flag ? "] has been set." : "] has been removed."));
+						}
+
+						listener->push_text("Flags: " + FormatFlags(_flags));
+
+						g_players.update_player(target);
+
+						g_accounts.save(acc_lock);
+					}
+					else
+					{
+						listener->push_text("Invalid player.");
+					}
+				}
+				else
+				{
+					listener->push_text("Invalid arguments.");
+				}
+			}
+			else
+			{
+				listener->push_text("Check your privilege.");
+			}
+			break;
+		}
+		case CMD_DISCONNECT:
+		{
+			if (account->flags & PF_SUPERADMIN)
+			{
+				// find cmd.v0 player and disconnect it
+				if (const auto target = g_players.get_player(cmd.v0))
+				{
+					listener->push_text("Not implemented.");
+				}
+				else
+				{
+					listener->push_text("Invalid player.");
+				}
+			}
+			else
+			{
+				listener->push_text("Check your privilege.");
+			}
+			break;
+		}
+		case CMD_INFO:
+		{
+			if (account->flags & PF_SUPERADMIN)
+			{
+				if (cmd.v0 == -1)
+				{
+					// display server statistics
+					std::string info = "\nServer statistics:";
+
+					append_server_info(info);
+
+					listener->push_text(info);
+				}
+				// find cmd.v0 player and display information
+				else if (const auto target = g_players.get_player(cmd.v0))
+				{
+					std::lock_guard<account_list_t> acc_lock(g_accounts);
+
+					std::string info;
+
+					info += "\nLogin: ";
+					info += target->account->name;
+					info += "\nName: ";
+					info += target->account->uniq_name;
+					info += "\nEmail: ";
+					info += target->account->email;
+					info += "\nFlags: ";
+					info += FormatFlags(target->account->flags);
+					
+					target->append_connection_info(info);
+					target->account->flood.append_info(info);
+
+					listener->push_text(info);
+				}
+				else
+				{
+					listener->push_text("Invalid player.");
+				}
+			}
+			else
+			{
+				listener->push_text("Check your privilege.");
+			}
+			break;
+		}
+		case CMD_CHANGE:
+		{
+			if (account->flags & PF_SUPERADMIN)
+			{
+				if (const auto target = g_players.get_player(cmd.v0))
+				{
+					listener->push_text("Not implemented.");
+				}
+				else
+				{
+					listener->push_text("Invalid player.");
+				}
+			}
+			else
+			{
+				listener->push_text("Check your privilege.");
+			}
+			break;
+		}
+		case CMD_SET_NAME:
+		{
+			if (account->flags & PF_SUPERADMIN)
+			{
+				// find cmd.v0 player and set unique name
+				if (const auto target = g_players.get_player(cmd.v0))
+				{
+					{
+						std::unique_lock<account_list_t> acc_lock(g_accounts);
+
+						target->account->uniq_name = { cmd.data, text_size };
+						target->refresh_name(acc_lock);
+
+						g_players.update_player(target);
+
+						g_accounts.save(acc_lock);
+					}
+
+					listener->push_text("Unique name set:"); // TODO (message)
+					listener->push_text({ cmd.data, std::min<u16>(48, text_size) });
+				}
+				else
+				{
+					listener->push_text("Invalid player.");
+				}
+			}
+			else
+			{
+				listener->push_text("Check your privilege.");
+			}
+			break;
+		}
+		case CMD_CALL:
+		{
+			if (account->flags & PF_SUPERADMIN)
+			{
+				// forcedly load player by login
+				listener->push_text("Not implemented.");
+			}
+			else
+			{
+				listener->push_text("Check your privilege.");
+			}
+			break;
+		}
+		case CMD_SET_NOTE:
+		{
+			if (account->flags & PF_SUPERADMIN)
+			{
+				// set new greeting message
+				listener->push_text("Not implemented.");
+			}
+			else
+			{
+				listener->push_text("Check your privilege.");
+			}
+			break;
+		}
+		case CMD_ADD_BAN:
+		{
+			if (account->flags & PF_SUPERADMIN)
+			{
+				// ban ip address
+				listener->push_text("Not implemented.");
+			}
+			else
+			{
+				listener->push_text("Check your privilege.");
+			}
+			break;
+		}
+		case CMD_CREATE_GAME:
+		{
+			listener->push_text("Not implemented.");
+			break;
+		}
+		case CMD_DELETE_GAME:
+		{
+			listener->push_text("Not implemented.");
+			break;
+		}
+		case CMD_GAME_OWNER:
+		{
+			listener->push_text("Not implemented.");
+			break;
+		}
+		case CMD_ADD_PLAYER:
+		{
+			listener->push_text("Not implemented.");
+			break;
+		}
+		case CMD_DELETE_PLAYER:
+		{
+			listener->push_text("Not implemented.");
+			break;
+		}
+		case CMD_JOIN_GAME:
+		{
+			listener->push_text("Not implemented.");
+			break;
+		}
+		default:
+		{
+			listener->push_text(fmt::format("Invalid command (cmd={:#x}, v0={:#x}, v1={:#x}, v2={:#x})", cmd.cmd, cmd.v0, cmd.v1, cmd.v2));
+		}
+		}
+	}
+	else if (header.code == CLIENT_SCMD && header.size == 2)
+	{
+		const u16 scmd = cmd.cmd;
+
+		switch (scmd)
+		{
+		case SCMD_NONE: break;
+
+		case SCMD_UPDATE_SERVER:
+		{
+			if (account->flags & PF_SUPERADMIN)
+			{
+				// restart server (TODO)
+				stop(0);
+			}
+			else
+			{
+				listener->push_text("Check your privilege.");
+			}
+			break;
+		}
+		case SCMD_HIDE:
+		{
+			if (throttle(FC_PRESENCE, 300, delay))
+			{
+				set_offline();
+			}
+			break;
+		}
+		case SCMD_SHOW:
+		{
+			if (throttle(FC_PRESENCE, 300, delay))
+			{
+				set_online();
+			}
+			break;
+		}
+		case SCMD_REFRESH:
+		{
+			// Update player list (it shouldn't be necessary to use it)
+			if (throttle(FC_REFRESH, 1000, delay))
+			{
+				g_players.send_player_list(*listener, player->index);
+			}
+			break;
+		}
+		case SCMD_QUIT:
+		{
+			// Quit manually
+
+			if (account->flags & PF_LOCK)
+			{
+				listener->push_text("You cannot quit now.");
+				return false;
+			}
+
+			listener->push_text("You have quit.");
+			listener->quit_flag.test_and_set();
+			return false;
+		}
+
+		default:
+		{
+			listener->push_text(fmt::format("Invalid command (scmd={:#x})", scmd));
+		}
+		}
+	}
+	else
+	{
+		listener->push_text(fmt::format("Invalid command (code={:#x}, size={})", +header.code, header.size));
+	}
+
+	return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "ep_defines.h"
+#include "ep_socket.h"
+#include "ep_flood.h"
+
+class account_t;
+class account_list_t;
+class player_t;
+class player_list_t;
+class listener_t;
+class serial_executor_t;
+class timer_task_t;
+
+extern account_list_t g_accounts;
+extern player_list_t g_players;
+
+extern packet_t g_keepalive_packet;
+extern packet_t g_auth_packet;
+extern u32 g_key_size;
+extern u32 g_idle_timeout;
+
+void stop(int x);
+
+// append server statistics (acceptors, etc.)
+void append_server_info(std::string& info);
+
+// Logged in client state (doesn't depend on the connection model used)
+class session_t final : public std::enable_shared_from_this<session_t>
+{
+	std::string m_cached_name;
+
+	std::shared_ptr<timer_task_t> m_timer; // keepalive and idle timeout
+
+	void on_timer();
+
+	// apply flood control to the command (rejection message is sent if necessary)
+	bool throttle(flood_class_t cls, u32 cost, u32& delay);
+
+public:
+	const std::shared_ptr<account_t> account;
+	const std::shared_ptr<player_t> player;
+	const std::shared_ptr<listener_t> listener;
+	const std::shared_ptr<serial_executor_t> executor; // command queue
+
+	std::atomic<u64> send_time; // last packet sending time (ms), must be updated by the sender
+	std::atomic<u64> activity_time; // last command time (ms)
+
+	session_t(const std::shared_ptr<account_t>& account, const std::shared_ptr<player_t>& player, const std::shared_ptr<listener_t>& listener);
+
+	// check whether the auth packet header is acceptable
+	static bool check_auth(const ProtocolHeader& header);
+
+	// decrypt CLIENT_SECURE_AUTH content in the crypto pool (callback is called there), return false if the pool is overloaded
+	static bool decrypt_auth(packet_t auth_info, std::function<void(packet_t)> callback);
+
+	// append handshake statistics
+	static void append_stats(std::string& info);
+
+	// process auth packet (empty auth_info means invalid header or rejection, CLIENT_SECURE_AUTH content must be decrypted), socket may be replaced with cipher_socket_t
+	// pass may point to md5 of the password field precomputed in batch (valid only for complete CLIENT_SECURE_AUTH content)
+	static std::shared_ptr<session_t> login(std::shared_ptr<socket_t>& socket, inaddr_t ip, u16 port, const ProtocolHeader& header, packet_t auth_info, const md5_t* pass = nullptr);
+
+	// start keepalive timer
+	void start();
+
+	void set_online();
+
+	void set_offline();
+
+	// execute client command (data contains header.size bytes), return false to stop receiving; delay is set to throttling time (ms)
+	bool execute(const ProtocolHeader& header, void* data, u32& delay);
+
+	// queue client command for execution in the worker pool (data points into the buffer which is kept alive), return false if the queue is stopped or full
+	bool submit(const ProtocolHeader& header, packet_t buffer, void* data, bool wait);
+
+	// stop the listener after all queued commands are executed
+	void finish();
+
+	// update player state after the listener stopped and send disconnection message
+	void disconnect(socket_t& socket);
+};
@@ -1,2 +1,64 @@
 #include "stdafx.h"
 #include "ep_socket.h"
+
+char* input_buffer_t::reserve(std::size_t size)
+{
+	if (m_begin == m_end && m_buf.unique())
+	{
+		// start from the aligned beginning
+		m_begin = m_decoded = m_end = 0;
+	}
+
+	if (space() >= size)
+	{
+		return &m_buf->get(m_end);
+	}
+
+	if (m_buf.unique())
+	{
+		// move unprocessed data to the beginning
+		std::memmove(m_buf->data(), data(), m_end - m_begin);
+		m_decoded -= m_begin;
+		m_end -= m_begin;
+		m_begin = 0;
+
+		if (space() >= size)
+		{
+			return &m_buf->get(m_end);
+		}
+	}
+
+	// allocate new buffer (the old one may be still used by queued commands)
+	packet_t buf(std::max<std::size_t>((m_end - m_begin + size) * 2, 16384));
+
+	if (m_buf)
+	{
+		std::memcpy(buf->data(), data(), m_end - m_begin);
+	}
+
+	m_buf = std::move(buf);
+	m_decoded -= m_begin;
+	m_end -= m_begin;
+	m_begin = 0;
+
+	return &m_buf->get(m_end);
+}
+
+bool input_buffer_t::get_frame(socket_t& socket, ProtocolHeader& header, std::size_t& frame_size)
+{
+	if (m_decoded < m_end)
+	{
+		m_decoded += socket.decode(&m_buf->get(m_decoded), m_end - m_decoded);
+	}
+
+	if (m_decoded - m_begin < sizeof(ProtocolHeader))
+	{
+		return false;
+	}
+
+	std::memcpy(&header, data(), sizeof(ProtocolHeader));
+
+	frame_size = socket.get_frame_size(sizeof(ProtocolHeader) + header.size);
+
+	return m_decoded - m_begin >= frame_size;
+}
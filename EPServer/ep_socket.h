@@ -1,13 +1,14 @@
 #pragma once
 
 #include "ep_defines.h"
-#include "rc6.h"
+#include "cipher.h"
 
 #ifdef _WIN32
 
 #include <winsock2.h>
 #define GETERROR WSAGetLastError()
 #define DROP(sid) closesocket(sid)
+#define WOULDBLOCK(err) ((err) == WSAEWOULDBLOCK)
 #define MSG_NOSIGNAL 0
 using socket_id_t = SOCKET;
 using inaddr_t = IN_ADDR;
@@ -16,11 +17,14 @@ using socklen_t = int;
 #else
 
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #define GETERROR errno
 #define DROP(sid) ::close(sid)
+#define WOULDBLOCK(err) ((err) == EAGAIN || (err) == EWOULDBLOCK)
 #define INVALID_SOCKET (-1)
 #define SOCKET_ERROR (-1)
 using socket_id_t = int;
@@ -39,8 +43,32 @@ template<typename... T> inline void ep_printf_ip(const char* fmt, inaddr_t ip, u
 class socket_t
 {
 protected:
+	enum : u32
+	{
+		max_buffers = 64, // max packets per scatter-gather call
+	};
+
+#ifdef _WIN32
+	using buffer_t = WSABUF;
+#else
+	using buffer_t = iovec;
+#endif
+
 	std::atomic<socket_id_t> m_socket;
 
+	bool m_nonblock = false;
+	bool m_deferred = false; // put() only saves data, the owner sends it asynchronously
+	std::vector<char> m_out; // unsent data (non-blocking mode)
+
+	// take socket from another object with its mode and unsent data
+	void replace(socket_t& socket)
+	{
+		reset(socket.release());
+		m_nonblock = socket.m_nonblock;
+		m_deferred = socket.m_deferred;
+		m_out.swap(socket.m_out);
+	}
+
 public:
 	socket_t()
 		: m_socket(INVALID_SOCKET)
@@ -82,6 +110,30 @@ public:
 		}
 	}
 
+	socket_id_t get_id() const
+	{
+		return m_socket;
+	}
+
+	// switch socket to non-blocking mode (put() will save unsent data)
+	bool set_nonblocking(bool deferred = false)
+	{
+		m_deferred = deferred;
+
+#ifdef _WIN32
+		u_long mode = 1;
+
+		if (ioctlsocket(m_socket, FIONBIO, &mode) == SOCKET_ERROR)
+#else
+		if (fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL) | O_NONBLOCK) == -1)
+#endif
+		{
+			return false;
+		}
+
+		return m_nonblock = true;
+	}
+
 	// send data
 	virtual bool put(const void* data, std::size_t size)
 	{
@@ -90,7 +142,29 @@ public:
 			return false; // TODO
 		}
 
-		return send(m_socket, static_cast<const char*>(data), static_cast<int>(size), MSG_NOSIGNAL) == size;
+		if (!m_nonblock)
+		{
+			return send(m_socket, static_cast<const char*>(data), static_cast<int>(size), MSG_NOSIGNAL) == size;
+		}
+
+		std::size_t sent = 0;
+
+		if (m_out.empty() && !m_deferred)
+		{
+			const auto res = send(m_socket, static_cast<const char*>(data), static_cast<int>(size), MSG_NOSIGNAL);
+
+			if (res == SOCKET_ERROR && !WOULDBLOCK(GETERROR))
+			{
+				return false;
+			}
+
+			sent = res == SOCKET_ERROR ? 0 : res;
+		}
+
+		// save the rest
+		m_out.insert(m_out.end(), static_cast<const char*>(data) + sent, static_cast<const char*>(data) + size);
+
+		return true;
 	}
 
 	// send data
@@ -99,6 +173,115 @@ public:
 		return put(&data, sizeof(T));
 	}
 
+	// send multiple packets with scatter-gather calls (without copying)
+	virtual bool put_packets(const packet_t* packets, std::size_t count)
+	{
+		while (count)
+		{
+			const u32 chunk = static_cast<u32>(std::min<std::size_t>(count, max_buffers));
+
+			buffer_t bufs[max_buffers];
+
+			for (u32 i = 0; i < chunk; i++)
+			{
+#ifdef _WIN32
+				bufs[i].buf = static_cast<CHAR*>(packets[i]->data());
+				bufs[i].len = static_cast<ULONG>(packets[i]->size);
+#else
+				bufs[i].iov_base = packets[i]->data();
+				bufs[i].iov_len = packets[i]->size;
+#endif
+			}
+
+			u32 first = 0; // first buffer not sent completely
+
+			if (m_out.empty() && !m_deferred)
+			{
+				while (first < chunk)
+				{
+#ifdef _WIN32
+					DWORD res = 0;
+
+					if (WSASend(m_socket, bufs + first, chunk - first, &res, 0, nullptr, nullptr) == SOCKET_ERROR)
+#else
+					msghdr msg{};
+					msg.msg_iov = bufs + first;
+					msg.msg_iovlen = chunk - first;
+
+					const auto res = sendmsg(m_socket, &msg, MSG_NOSIGNAL);
+
+					if (res == SOCKET_ERROR)
+#endif
+					{
+						if (m_nonblock && WOULDBLOCK(GETERROR))
+						{
+							break;
+						}
+
+						return false;
+					}
+
+					// skip sent data
+					for (std::size_t sent = res; first < chunk; first++)
+					{
+#ifdef _WIN32
+						if (bufs[first].len > sent)
+						{
+							bufs[first].buf += sent;
+							bufs[first].len -= static_cast<ULONG>(sent);
+							break;
+						}
+
+						sent -= bufs[first].len;
+#else
+						if (bufs[first].iov_len > sent)
+						{
+							bufs[first].iov_base = static_cast<char*>(bufs[first].iov_base) + sent;
+							bufs[first].iov_len -= sent;
+							break;
+						}
+
+						sent -= bufs[first].iov_len;
+#endif
+					}
+				}
+			}
+
+			// save the rest (non-blocking mode)
+			for (u32 i = first; i < chunk; i++)
+			{
+#ifdef _WIN32
+				m_out.insert(m_out.end(), bufs[i].buf, bufs[i].buf + bufs[i].len);
+#else
+				m_out.insert(m_out.end(), static_cast<char*>(bufs[i].iov_base), static_cast<char*>(bufs[i].iov_base) + bufs[i].iov_len);
+#endif
+			}
+
+			packets += chunk;
+			count -= chunk;
+		}
+
+		return true;
+	}
+
+	// queue packets for sending, encryption may be deferred until get_staged() (reactor mode)
+	virtual bool stage_packets(const packet_t* packets, std::size_t count)
+	{
+		return put_packets(packets, count);
+	}
+
+	// get deferred encryption job, it must be done before put_staged() is called
+	virtual bool get_staged(cipher_job_t& job)
+	{
+		return false;
+	}
+
+	// send packets queued by stage_packets()
+	virtual bool put_staged()
+	{
+		return true;
+	}
+
 	// receive data
 	virtual bool get(void* data, std::size_t size)
 	{
@@ -116,10 +299,61 @@ public:
 		return get(&data, sizeof(T));
 	}
 
+	// receive available data (at least one byte is received in blocking mode), return recv() result
+	int receive(void* data, std::size_t size)
+	{
+		return static_cast<int>(recv(m_socket, static_cast<char*>(data), static_cast<int>(std::min<std::size_t>(size, INT_MAX)), 0));
+	}
+
 	// clear cipher padding in input buffer
 	virtual void flush()
 	{
 	}
+
+	// get unsent data size (non-blocking mode)
+	std::size_t pending() const
+	{
+		return m_out.size();
+	}
+
+	// try to send saved data (non-blocking mode)
+	bool send_pending()
+	{
+		if (m_out.empty())
+		{
+			return true;
+		}
+
+		const auto res = send(m_socket, m_out.data(), static_cast<int>(std::min<std::size_t>(m_out.size(), INT_MAX)), MSG_NOSIGNAL);
+
+		if (res == SOCKET_ERROR)
+		{
+			return WOULDBLOCK(GETERROR);
+		}
+
+		m_out.erase(m_out.begin(), m_out.begin() + res);
+
+		return true;
+	}
+
+	// take saved data to send it asynchronously (deferred mode)
+	void take_pending(std::vector<char>& data)
+	{
+		data.clear();
+		data.swap(m_out);
+	}
+
+	// decode received data in place, return the amount of data decoded (non-blocking mode)
+	virtual std::size_t decode(void* data, std::size_t size)
+	{
+		return size;
+	}
+
+	// get amount of raw data occupied by a message of specified size
+	virtual std::size_t get_frame_size(std::size_t size) const
+	{
+		return size;
+	}
 };
 
 class server_socket_t : public socket_t
@@ -133,80 +367,196 @@ public:
 class cipher_socket_t : public socket_t
 {
 protected:
-	rc6_cipher_t m_cipher;
-	short_str_t<15> m_received{};
-
-public:
-	cipher_socket_t(socket_id_t socket, const packet_t& key)
-		: socket_t(socket)
-		, m_cipher(key)
+	enum : std::size_t
 	{
-	}
+		arena_limit = 0x10000, // max size of encrypted data sent at once (if possible)
+	};
+
+	std::unique_ptr<cipher_t> m_cipher;
+
+	std::unique_ptr<cipher_ctr_t> m_ctr_in; // CTR mode state (CBC mode is used if not set)
+	std::unique_ptr<cipher_ctr_t> m_ctr_out;
 
-	virtual ~cipher_socket_t() override
+	std::unique_ptr<cipher_block_t[]> m_arena; // output buffer (data is encrypted before sending)
+	std::size_t m_arena_size = 0; // allocated bytes
+	std::size_t m_arena_used = 0; // bytes to send
+	std::size_t m_arena_staged = 0; // start of data not encrypted yet
+
+	char* arena_data(std::size_t pos) const
 	{
-		m_received = {}; // burn
+		return reinterpret_cast<char*>(m_arena.get()) + pos;
 	}
 
-	virtual bool put(const void* data, std::size_t size) override
+	// append frame to the output buffer (padded in CBC mode)
+	void stage_frame(const void* data, std::size_t size)
 	{
-		const auto asize = size + 15 & ~15;
+		const std::size_t frame_size = get_frame_size(size);
+
+		if (m_arena_size - m_arena_used < frame_size)
+		{
+			const std::size_t new_size = std::max<std::size_t>(std::max<std::size_t>(m_arena_size * 2, (m_arena_used + frame_size + 15) & ~15), 4096);
 
-		std::unique_ptr<rc6_block_t[]> buf(new rc6_block_t[asize / 16]);
+			std::unique_ptr<cipher_block_t[]> arena(new cipher_block_t[new_size / 16]);
+			std::memcpy(arena.get(), m_arena.get(), m_arena_used);
 
-		std::memcpy(buf.get(), data, size);
+			m_arena = std::move(arena);
+			m_arena_size = new_size;
+		}
 
-		std::memset(reinterpret_cast<u8*>(buf.get()) + size, 0, asize - size); // zero padding
+		const auto frame = arena_data(m_arena_used);
 
-		for (std::size_t i = 0; i < asize / 16; i++)
+		if (frame_size != size)
 		{
-			m_cipher.encrypt_block_cbc(buf[i]);
+			std::memset(frame + frame_size - 16, 0, 16); // zero padding
 		}
 
-		return socket_t::put(buf.get(), asize);
+		std::memcpy(frame, data, size);
+
+		m_arena_used += frame_size;
 	}
 
-	virtual bool get(void* data, std::size_t size) override
+	void encrypt_staged()
 	{
-		// try to get saved data
-		if (const auto read = std::min<std::size_t>(m_received.size(), size))
+		if (m_ctr_out)
 		{
-			std::memcpy(data, m_received.data(), read);
-			m_received = { m_received.data() + read, m_received.size() - read }; // shrink saved data
+			m_ctr_out->apply(*m_cipher, arena_data(m_arena_staged), m_arena_used - m_arena_staged);
+			m_arena_staged = m_arena_used;
+			return;
+		}
+
+		m_cipher->encrypt_cbc(reinterpret_cast<cipher_block_t*>(arena_data(m_arena_staged)), (m_arena_used - m_arena_staged) / 16);
+		m_arena_staged = m_arena_used;
+	}
+
+	bool send_arena()
+	{
+		const std::size_t size = m_arena_used;
+
+		m_arena_used = 0;
+		m_arena_staged = 0;
+
+		return !size || socket_t::put(m_arena.get(), size);
+	}
+
+public:
+	// replace plain socket (non-blocking or deferred mode is kept, so the owner doesn't need to set it again)
+	cipher_socket_t(socket_t& socket, std::unique_ptr<cipher_t> cipher)
+		: m_cipher(std::move(cipher))
+	{
+		replace(socket);
+	}
 
-			size -= read;
-			data = static_cast<u8*>(data) + read;
+	// switch both directions to another cipher or CTR mode (must be called before any data is received)
+	void set_mode(std::unique_ptr<cipher_t> cipher, bool ctr)
+	{
+		if (cipher)
+		{
+			m_cipher = std::move(cipher);
 		}
 
-		// try to receive new data from socket
-		if (const auto asize = size + 15 & ~15)
+		if (ctr)
 		{
-			std::unique_ptr<rc6_block_t[]> buf(new rc6_block_t[asize / 16]);
+			m_ctr_in.reset(new cipher_ctr_t(0));
+			m_ctr_out.reset(new cipher_ctr_t(1));
+		}
+	}
 
-			if (!socket_t::get(buf.get(), asize))
+	virtual bool put(const void* data, std::size_t size) override
+	{
+		stage_frame(data, size);
+		encrypt_staged();
+
+		return send_arena();
+	}
+
+	virtual bool put_packets(const packet_t* packets, std::size_t count) override
+	{
+		// encrypt frames back to back and send them at once
+		for (std::size_t i = 0; i < count; i++)
+		{
+			if (m_arena_used && m_arena_used + packets[i]->size > arena_limit && (encrypt_staged(), !send_arena()))
 			{
 				return false;
 			}
 
-			for (u32 i = 0; i < asize / 16; i++)
-			{
-				m_cipher.decrypt_block_cbc(buf[i]);
-			}
-			
-			std::memcpy(data, buf.get(), size);
-			m_received = { reinterpret_cast<char*>(buf.get()) + size, asize - size }; // save exceeded data
+			stage_frame(packets[i]->data(), packets[i]->size);
+		}
+
+		encrypt_staged();
+
+		return send_arena();
+	}
 
-			std::memset(buf.get(), 0, asize); // burn
+	virtual bool stage_packets(const packet_t* packets, std::size_t count) override
+	{
+		if (m_ctr_out)
+		{
+			return put_packets(packets, count); // nothing to batch
+		}
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			stage_frame(packets[i]->data(), packets[i]->size);
 		}
 
 		return true;
 	}
 
-	virtual void flush() override
+	virtual bool get_staged(cipher_job_t& job) override
 	{
-		m_received.clear(); // clear saved data
+		if (m_arena_staged == m_arena_used)
+		{
+			return false;
+		}
 
-		return socket_t::flush();
+		job = { m_cipher.get(), reinterpret_cast<cipher_block_t*>(arena_data(m_arena_staged)), (m_arena_used - m_arena_staged) / 16 };
+		m_arena_staged = m_arena_used;
+		return true;
+	}
+
+	virtual bool put_staged() override
+	{
+		return send_arena();
+	}
+
+	virtual std::size_t decode(void* data, std::size_t size) override
+	{
+		if (m_ctr_in)
+		{
+			m_ctr_in->apply(*m_cipher, data, size);
+
+			return size;
+		}
+
+		if (reinterpret_cast<std::uintptr_t>(data) % alignof(cipher_block_t) == 0)
+		{
+			// decrypt in place
+			m_cipher->decrypt_cbc(static_cast<cipher_block_t*>(data), size / 16);
+
+			return size & ~15;
+		}
+
+		cipher_block_t blocks[16]; // data is unaligned
+
+		for (std::size_t i = 0; i < size / 16;)
+		{
+			const std::size_t count = std::min<std::size_t>(size / 16 - i, 16);
+
+			std::memcpy(blocks, static_cast<u8*>(data) + i * 16, count * 16);
+			m_cipher->decrypt_cbc(blocks, count);
+			std::memcpy(static_cast<u8*>(data) + i * 16, blocks, count * 16);
+
+			i += count;
+		}
+
+		std::memset(blocks, 0, sizeof(blocks)); // burn
+
+		return size & ~15;
+	}
+
+	virtual std::size_t get_frame_size(std::size_t size) const override
+	{
+		return m_ctr_out ? size : (size + 15) & ~15;
 	}
 };
 
@@ -230,3 +580,56 @@ public:
 		return socket_t::flush();
 	}
 };
+
+// Receive buffer for multiple messages (queued commands refer to the data without copying it)
+class input_buffer_t final
+{
+	packet_t m_buf;
+	std::size_t m_begin = 0; // start of unprocessed data
+	std::size_t m_decoded = 0; // end of decoded data
+	std::size_t m_end = 0; // end of received data
+
+public:
+	// get free space for at least size bytes
+	char* reserve(std::size_t size);
+
+	// get free space size
+	std::size_t space() const
+	{
+		return m_buf ? m_buf->size - m_end : 0;
+	}
+
+	// add received data
+	void commit(std::size_t size)
+	{
+		m_end += size;
+	}
+
+	// get unprocessed data
+	char* data() const
+	{
+		return &m_buf->get(m_begin);
+	}
+
+	// get unprocessed data size
+	std::size_t size() const
+	{
+		return m_end - m_begin;
+	}
+
+	// get the buffer to keep data() alive
+	const packet_t& get_buffer() const
+	{
+		return m_buf;
+	}
+
+	// skip processed data
+	void consume(std::size_t size)
+	{
+		m_begin += size;
+		m_decoded = std::max(m_decoded, m_begin);
+	}
+
+	// decode new data and get the next complete message (frame_size includes header and padding)
+	bool get_frame(socket_t& socket, ProtocolHeader& header, std::size_t& frame_size);
+};
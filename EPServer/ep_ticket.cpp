@@ -0,0 +1,230 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_ticket.h"
+#include "rc6.h"
+#include "md5.h"
+
+#include <random>
+
+ticket_list_t g_tickets;
+
+namespace
+{
+#pragma pack(push, 1)
+
+	struct ticket_content_t
+	{
+		u64 expires; // monotonic time (ms)
+		ClientAuthRec info;
+		char secret[32];
+		u8 modes;
+		u8 ciphers;
+	};
+
+#pragma pack(pop)
+
+	static_assert(sizeof(ticket_content_t) <= sizeof(TicketRec::data), "Invalid ticket size");
+
+	void random_bytes(void* data, std::size_t size)
+	{
+		static std::mutex mutex;
+		static std::random_device rd; // opened once
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (std::size_t i = 0; i < size; i += 4)
+		{
+			const u32 value = rd();
+			std::memcpy(static_cast<u8*>(data) + i, &value, std::min<std::size_t>(size - i, 4));
+		}
+	}
+
+	// md5 HMAC of two concatenated data parts (key size must not exceed 64 bytes)
+	md5_t hmac_md5(const void* key, std::size_t key_size, const void* data1, std::size_t size1, const void* data2, std::size_t size2)
+	{
+		u8 pad[64]{};
+		std::memcpy(pad, key, key_size);
+
+		for (auto& c : pad)
+		{
+			c ^= 0x36;
+		}
+
+		md5_hasher_t inner;
+		inner.update(pad, 64);
+		inner.update(data1, size1);
+		inner.update(data2, size2);
+		const md5_t digest = inner.finish();
+
+		for (auto& c : pad)
+		{
+			c ^= 0x36 ^ 0x5c;
+		}
+
+		md5_hasher_t outer;
+		outer.update(pad, 64);
+		outer.update(digest.data(), 16);
+
+		std::memset(pad, 0, sizeof(pad)); // burn
+
+		return outer.finish();
+	}
+}
+
+ticket_list_t::ticket_list_t()
+{
+}
+
+ticket_list_t::~ticket_list_t()
+{
+	std::memset(m_mac_key.data(), 0, m_mac_key.size()); // burn
+}
+
+void ticket_list_t::start(u32 lifetime)
+{
+	char key[32];
+	random_bytes(key, sizeof(key));
+	random_bytes(m_mac_key.data(), m_mac_key.size());
+
+	m_cipher.reset(new rc6_cipher_t(packet_t{ key, sizeof(key) }));
+	m_lifetime = lifetime;
+
+	std::memset(key, 0, sizeof(key)); // burn
+}
+
+void ticket_list_t::apply(u64 id, void* data) const
+{
+	const std::size_t count = sizeof(TicketRec::data) / 16;
+
+	cipher_block_t keys[count];
+	m_cipher->make_keystream(keys, count, id << 3, 2); // separate counter range for each ticket
+
+	for (std::size_t i = 0; i < sizeof(TicketRec::data); i++)
+	{
+		static_cast<u8*>(data)[i] ^= reinterpret_cast<const u8*>(keys)[i];
+	}
+
+	std::memset(keys, 0, sizeof(keys)); // burn
+}
+
+md5_t ticket_list_t::sign(const TicketRec& ticket) const
+{
+	return hmac_md5(m_mac_key.data(), m_mac_key.size(), &ticket.id, sizeof(ticket.id), ticket.data, sizeof(ticket.data));
+}
+
+packet_t ticket_list_t::issue(const ClientAuthRec& info, u8 modes, u8 ciphers)
+{
+	packet_t packet(sizeof(ServerTicketRec));
+
+	auto& rec = packet->get<ServerTicketRec>();
+	rec.header = { SERVER_SESSION_TICKET, sizeof(ServerTicketRec) - sizeof(ProtocolHeader) };
+	rec.lifetime = m_lifetime;
+	random_bytes(rec.secret, sizeof(rec.secret));
+
+	ticket_content_t content{};
+	content.expires = get_time_ms() + m_lifetime * u64{ 1000 };
+	content.info = info;
+	std::memcpy(content.secret, rec.secret, sizeof(content.secret));
+	content.modes = modes;
+	content.ciphers = ciphers;
+
+	rec.ticket.id = ++m_last_id;
+	std::memset(rec.ticket.data, 0, sizeof(rec.ticket.data));
+	std::memcpy(rec.ticket.data, &content, sizeof(content));
+	apply(rec.ticket.id, rec.ticket.data);
+	rec.ticket.mac = sign(rec.ticket);
+
+	std::memset(&content, 0, sizeof(content)); // burn
+
+	m_issued++;
+
+	return packet;
+}
+
+packet_t ticket_list_t::redeem(const ClientResumeRec& rec)
+{
+	if (!is_enabled())
+	{
+		return{};
+	}
+
+	TicketRec ticket = rec.ticket;
+
+	// check MAC (constant time)
+	const md5_t mac = sign(ticket);
+	u8 diff = 0;
+
+	for (u32 i = 0; i < 16; i++)
+	{
+		diff |= mac[i] ^ ticket.mac[i];
+	}
+
+	if (diff)
+	{
+		m_rejected++;
+		return{};
+	}
+
+	apply(ticket.id, ticket.data);
+
+	ticket_content_t content;
+	std::memcpy(&content, ticket.data, sizeof(content));
+	std::memset(ticket.data, 0, sizeof(ticket.data)); // burn
+
+	const u64 now = get_time_ms();
+
+	bool valid = content.expires > now;
+
+	if (valid)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// remove expired tickets (only the front of the queue is checked)
+		while (!m_expiry.empty() && m_expiry.top().first <= now)
+		{
+			m_used.erase(m_expiry.top().second);
+			m_expiry.pop();
+		}
+
+		valid = m_used.emplace(ticket.id, content.expires).second; // single use
+
+		if (valid)
+		{
+			m_expiry.emplace(content.expires, ticket.id);
+		}
+	}
+
+	if (!valid)
+	{
+		std::memset(&content, 0, sizeof(content)); // burn
+		m_rejected++;
+		return{};
+	}
+
+	packet_t result(sizeof(SecureAuthExRec));
+
+	auto& auth = result->get<SecureAuthExRec>();
+	auth.auth.info = content.info;
+	auth.sign = SecureAuthExRec::signature;
+	auth.modes = content.modes;
+	auth.ciphers = content.ciphers;
+	auth.flags = SECURE_TICKET;
+
+	// derive session key
+	const u8 part1 = 1, part2 = 2;
+	const md5_t key1 = hmac_md5(content.secret, sizeof(content.secret), rec.nonce, sizeof(rec.nonce), &part1, 1);
+	const md5_t key2 = hmac_md5(content.secret, sizeof(content.secret), rec.nonce, sizeof(rec.nonce), &part2, 1);
+	std::memcpy(auth.auth.ckey, key1.data(), 16);
+	std::memcpy(auth.auth.ckey + 16, key2.data(), 16);
+
+	std::memset(&content, 0, sizeof(content)); // burn
+
+	m_resumed++;
+
+	return result;
+}
+
+void ticket_list_t::append_stats(std::string& info)
+{
+	info += fmt::format("\nTickets: {} issued, {} resumed, {} rejected", m_issued.load(), m_resumed.load(), m_rejected.load());
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "ep_defines.h"
+
+class rc6_cipher_t;
+
+// Session resumption tickets (encrypted with a random key generated at startup)
+class ticket_list_t final
+{
+	std::unique_ptr<rc6_cipher_t> m_cipher; // ticket encryption (CTR mode, ticket id is the counter)
+	md5_t m_mac_key;
+
+	std::atomic<u64> m_last_id{ 0 };
+	std::atomic<u64> m_issued{ 0 };
+	std::atomic<u64> m_resumed{ 0 };
+	std::atomic<u64> m_rejected{ 0 };
+
+	std::mutex m_mutex;
+	std::unordered_map<u64, u64> m_used; // used ticket id -> expiration time (protected by m_mutex)
+	std::priority_queue<std::pair<u64, u64>, std::vector<std::pair<u64, u64>>, std::greater<std::pair<u64, u64>>> m_expiry; // used tickets ordered by expiration time (protected by m_mutex)
+
+	u32 m_lifetime = 0; // seconds
+
+	// encrypt or decrypt ticket content
+	void apply(u64 id, void* data) const;
+
+	// calculate ticket MAC
+	md5_t sign(const TicketRec& ticket) const;
+
+public:
+	ticket_list_t();
+
+	~ticket_list_t();
+
+	// generate keys and enable tickets (lifetime in seconds)
+	void start(u32 lifetime);
+
+	bool is_enabled() const
+	{
+		return m_lifetime != 0;
+	}
+
+	// create SERVER_SESSION_TICKET message for the login data (password isn't hashed yet)
+	packet_t issue(const ClientAuthRec& info, u8 modes, u8 ciphers);
+
+	// check ticket and make SecureAuthExRec content with derived session key (empty if the ticket is invalid, expired or used)
+	packet_t redeem(const ClientResumeRec& rec);
+
+	void append_stats(std::string& info);
+};
+
+extern ticket_list_t g_tickets;
@@ -0,0 +1,158 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_timer.h"
+
+timer_service_t g_timers;
+
+timer_wheel_t::timer_wheel_t(u64 now)
+	: m_now(now)
+{
+}
+
+void timer_wheel_t::place(timer_node_t& node)
+{
+	const u64 time = std::max(node.m_time, m_now);
+	const u64 delta = time - m_now;
+
+	if (delta < 1 << root_bits)
+	{
+		node.link(m_root[time & ((1 << root_bits) - 1)]);
+		return;
+	}
+
+	for (u32 level = 0; level < level_count; level++)
+	{
+		const u32 shift = root_bits + (level + 1) * level_bits;
+
+		if (delta < u64{ 1 } << shift || level == level_count - 1)
+		{
+			// far timers are placed at the maximal distance and replaced later
+			const u64 placed = m_now + std::min<u64>(delta, (u64{ 1 } << shift) - 1);
+
+			node.link(m_levels[level][(placed >> (shift - level_bits)) & ((1 << level_bits) - 1)]);
+			return;
+		}
+	}
+}
+
+u64 timer_wheel_t::next_time() const
+{
+	for (u32 i = 0; i < 1 << root_bits; i++)
+	{
+		if (m_root[(m_now + i) & ((1 << root_bits) - 1)].is_scheduled())
+		{
+			return m_now + i;
+		}
+	}
+
+	for (const auto& level : m_levels)
+	{
+		for (const auto& slot : level)
+		{
+			if (slot.is_scheduled())
+			{
+				// next cascade time
+				return (m_now + ((1 << root_bits) - 1)) & ~u64{ (1 << root_bits) - 1 };
+			}
+		}
+	}
+
+	return UINT64_MAX;
+}
+
+timer_service_t::timer_service_t()
+	: m_wheel(get_time_ms())
+{
+}
+
+void timer_service_t::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	std::vector<std::shared_ptr<timer_task_t>> expired;
+
+	while (!m_exit)
+	{
+		m_wheel.advance(get_time_ms(), [&](timer_node_t& node)
+		{
+			expired.emplace_back(std::move(static_cast<timer_task_t&>(node).m_self));
+		});
+
+		if (!expired.empty())
+		{
+			lock.unlock();
+
+			for (const auto& timer : expired)
+			{
+				timer->callback();
+			}
+
+			expired.clear();
+			lock.lock();
+			continue;
+		}
+
+		m_wake_time = m_wheel.next_time();
+
+		if (m_wake_time == UINT64_MAX)
+		{
+			m_cond.wait(lock);
+		}
+		else
+		{
+			m_cond.wait_for(lock, std::chrono::milliseconds(m_wake_time - std::min(m_wake_time, get_time_ms())));
+		}
+	}
+
+	m_started = false;
+	m_cond.notify_all();
+}
+
+void timer_service_t::start()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_started = true;
+
+	std::thread(&timer_service_t::run, this).detach();
+}
+
+void timer_service_t::stop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_exit = true;
+	m_cond.notify_all();
+
+	m_cond.wait(lock, [&]
+	{
+		return !m_started;
+	});
+}
+
+void timer_service_t::schedule(const std::shared_ptr<timer_task_t>& timer, u64 time)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_wheel.schedule(*timer, time);
+	timer->m_self = timer;
+
+	if (time < m_wake_time)
+	{
+		m_wake_time = time;
+		m_cond.notify_one();
+	}
+}
+
+void timer_service_t::cancel(const std::shared_ptr<timer_task_t>& timer)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_wheel.cancel(*timer);
+	timer->m_self.reset();
+}
+
+void timer_service_t::post(std::function<void()> func, u32 delay_ms)
+{
+	schedule(std::make_shared<timer_task_t>(std::move(func)), get_time_ms() + delay_ms);
+}
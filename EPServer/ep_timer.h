@@ -0,0 +1,185 @@
+#pragma once
+#include "ep_defines.h"
+
+// Timer wheel entry (intrusive list node)
+class timer_node_t
+{
+	friend class timer_wheel_t;
+
+	timer_node_t* m_prev;
+	timer_node_t* m_next;
+	u64 m_time = 0;
+
+	void unlink()
+	{
+		m_prev->m_next = m_next;
+		m_next->m_prev = m_prev;
+		m_prev = m_next = this;
+	}
+
+	// insert before head (at the end of the list)
+	void link(timer_node_t& head)
+	{
+		m_prev = head.m_prev;
+		m_next = &head;
+		head.m_prev->m_next = this;
+		head.m_prev = this;
+	}
+
+public:
+	timer_node_t()
+		: m_prev(this)
+		, m_next(this)
+	{
+	}
+
+	timer_node_t(const timer_node_t&) = delete;
+
+	~timer_node_t()
+	{
+		unlink();
+	}
+
+	bool is_scheduled() const
+	{
+		return m_next != this;
+	}
+
+	// expiration time (ms)
+	u64 get_time() const
+	{
+		return m_time;
+	}
+};
+
+// Hierarchical timer wheel with 1 ms resolution (not thread-safe)
+class timer_wheel_t final
+{
+	enum : u32
+	{
+		root_bits = 8,
+		level_bits = 6,
+		level_count = 3,
+	};
+
+	std::array<timer_node_t, 1 << root_bits> m_root;
+	std::array<std::array<timer_node_t, 1 << level_bits>, level_count> m_levels;
+
+	u64 m_now; // next time to process
+
+	void place(timer_node_t& node);
+
+public:
+	explicit timer_wheel_t(u64 now);
+
+	// schedule or reschedule the node
+	void schedule(timer_node_t& node, u64 time)
+	{
+		node.unlink();
+		node.m_time = time;
+		place(node);
+	}
+
+	void cancel(timer_node_t& node)
+	{
+		node.unlink();
+	}
+
+	// get time of the next advance() call which may expire something (UINT64_MAX if empty)
+	u64 next_time() const;
+
+	// process time until now, func is called for expired nodes (already removed, may be rescheduled)
+	template<typename F> void advance(u64 now, F func)
+	{
+		while (m_now <= now)
+		{
+			const u32 index = m_now & ((1 << root_bits) - 1);
+
+			if (index == 0)
+			{
+				// move nodes from higher levels
+				for (u32 level = 0; level < level_count; level++)
+				{
+					const u32 slot = (m_now >> (root_bits + level * level_bits)) & ((1 << level_bits) - 1);
+
+					timer_node_t list;
+					list.link(m_levels[level][slot]);
+					m_levels[level][slot].unlink();
+
+					while (list.is_scheduled())
+					{
+						auto& node = *list.m_next;
+						node.unlink();
+						place(node);
+					}
+
+					if (slot != 0)
+					{
+						break;
+					}
+				}
+			}
+
+			// take expired nodes
+			timer_node_t list;
+			list.link(m_root[index]);
+			m_root[index].unlink();
+
+			m_now++;
+
+			while (list.is_scheduled())
+			{
+				auto& node = *list.m_next;
+				node.unlink();
+				func(node);
+			}
+		}
+	}
+};
+
+// Shared timer with callback
+class timer_task_t final : public timer_node_t
+{
+	friend class timer_service_t;
+
+	std::shared_ptr<timer_task_t> m_self; // keeps the timer alive while scheduled
+
+public:
+	const std::function<void()> callback;
+
+	explicit timer_task_t(std::function<void()> callback)
+		: callback(std::move(callback))
+	{
+	}
+};
+
+// Timer thread with shared timer wheel
+class timer_service_t final
+{
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	timer_wheel_t m_wheel;
+	u64 m_wake_time = UINT64_MAX; // time the thread is waiting for
+	bool m_started = false;
+	bool m_exit = false;
+
+	void run();
+
+public:
+	timer_service_t();
+
+	void start();
+
+	// stop timer thread (remaining timers are discarded)
+	void stop();
+
+	// schedule or reschedule timer (callback is called in the timer thread)
+	void schedule(const std::shared_ptr<timer_task_t>& timer, u64 time);
+
+	void cancel(const std::shared_ptr<timer_task_t>& timer);
+
+	// call func after delay_ms
+	void post(std::function<void()> func, u32 delay_ms);
+};
+
+extern timer_service_t g_timers;
@@ -0,0 +1,204 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_uring.h"
+
+#ifdef HAVE_IO_URING
+
+#include <csignal>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace
+{
+	int io_uring_setup(u32 entries, io_uring_params* params)
+	{
+		return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+	}
+
+	int io_uring_enter(int fd, u32 to_submit, u32 min_complete, u32 flags, const void* arg, std::size_t argsz)
+	{
+		return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz));
+	}
+
+	int io_uring_register(int fd, u32 opcode, const void* arg, u32 nr_args)
+	{
+		return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+	}
+}
+
+uring_t::~uring_t()
+{
+	if (m_buffers) munmap(m_buffers, std::size_t{ m_buf_count } * m_buf_size);
+	if (m_br) munmap(m_br, m_br_size);
+	if (m_sqes) munmap(m_sqes, m_sqes_size);
+	if (m_cq_ptr && m_cq_ptr != m_sq_ptr) munmap(m_cq_ptr, m_cq_size);
+	if (m_sq_ptr) munmap(m_sq_ptr, m_sq_size);
+	if (m_fd != -1) ::close(m_fd);
+}
+
+bool uring_t::init(u32 entries, u32 buf_count, u32 buf_size)
+{
+	io_uring_params params{};
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = entries * 4; // multishot receives may produce many completions
+
+	if ((m_fd = io_uring_setup(entries, &params)) < 0)
+	{
+		fmt::print("io_uring_setup() failed: {:#x}\n", errno);
+		return false;
+	}
+
+	if (~params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		fmt::print("io_uring: kernel is too old\n");
+		return false;
+	}
+
+	m_ext_arg = (params.features & IORING_FEAT_EXT_ARG) != 0;
+
+	m_sq_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+	m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+
+	m_sq_ptr = m_cq_ptr = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+
+	if (m_sq_ptr == MAP_FAILED)
+	{
+		m_sq_ptr = m_cq_ptr = nullptr;
+		fmt::print("io_uring: mmap() failed: {:#x}\n", errno);
+		return false;
+	}
+
+	m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+	m_sqes = static_cast<io_uring_sqe*>(mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES));
+
+	if (m_sqes == MAP_FAILED)
+	{
+		m_sqes = nullptr;
+		fmt::print("io_uring: mmap() failed: {:#x}\n", errno);
+		return false;
+	}
+
+	const auto sq = static_cast<u8*>(m_sq_ptr);
+	m_sq_head = reinterpret_cast<u32*>(sq + params.sq_off.head);
+	m_sq_tail = reinterpret_cast<u32*>(sq + params.sq_off.tail);
+	m_sq_mask = *reinterpret_cast<u32*>(sq + params.sq_off.ring_mask);
+	m_sq_entries = *reinterpret_cast<u32*>(sq + params.sq_off.ring_entries);
+	m_sq_array = reinterpret_cast<u32*>(sq + params.sq_off.array);
+	m_sq_local_tail = *m_sq_tail;
+
+	const auto cq = static_cast<u8*>(m_cq_ptr);
+	m_cq_head = reinterpret_cast<u32*>(cq + params.cq_off.head);
+	m_cq_tail = reinterpret_cast<u32*>(cq + params.cq_off.tail);
+	m_cq_mask = *reinterpret_cast<u32*>(cq + params.cq_off.ring_mask);
+	m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+	// allocate and register provided buffer ring
+	m_buf_count = buf_count;
+	m_buf_size = buf_size;
+	m_br_size = buf_count * sizeof(io_uring_buf);
+
+	const auto br = mmap(nullptr, m_br_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	const auto buffers = mmap(nullptr, std::size_t{ buf_count } * buf_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	m_br = br == MAP_FAILED ? nullptr : static_cast<io_uring_buf_ring*>(br);
+	m_buffers = buffers == MAP_FAILED ? nullptr : static_cast<u8*>(buffers);
+
+	if (!m_br || !m_buffers)
+	{
+		fmt::print("io_uring: buffer allocation failed\n");
+		return false;
+	}
+
+	io_uring_buf_reg reg{};
+	reg.ring_addr = reinterpret_cast<u64>(m_br);
+	reg.ring_entries = buf_count;
+	reg.bgid = buffer_group;
+
+	if (io_uring_register(m_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+	{
+		if (errno == EINVAL)
+		{
+			fmt::print("io_uring: kernel doesn't support provided buffer rings (Linux 5.19 or newer is required)\n");
+		}
+		else
+		{
+			fmt::print("io_uring: buffer ring registration failed: {:#x}\n", errno);
+		}
+
+		return false;
+	}
+
+	for (u32 i = 0; i < buf_count; i++)
+	{
+		put_buffer(static_cast<u16>(i));
+	}
+
+	return true;
+}
+
+io_uring_sqe* uring_t::get_sqe()
+{
+	if (m_sq_local_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) >= m_sq_entries)
+	{
+		// submission queue is full
+		__atomic_store_n(m_sq_tail, m_sq_local_tail, __ATOMIC_RELEASE);
+
+		const int res = io_uring_enter(m_fd, m_to_submit, 0, 0, nullptr, 0);
+
+		m_to_submit -= res > 0 ? res : 0;
+
+		if (m_sq_local_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) >= m_sq_entries)
+		{
+			return nullptr;
+		}
+	}
+
+	const u32 index = m_sq_local_tail++ & m_sq_mask;
+	const auto sqe = m_sqes + index;
+
+	std::memset(sqe, 0, sizeof(io_uring_sqe));
+	m_sq_array[index] = index;
+	m_to_submit++;
+
+	return sqe;
+}
+
+int uring_t::submit_and_wait(int timeout_ms)
+{
+	__atomic_store_n(m_sq_tail, m_sq_local_tail, __ATOMIC_RELEASE);
+
+	__kernel_timespec ts{};
+	ts.tv_sec = timeout_ms / 1000;
+	ts.tv_nsec = timeout_ms % 1000 * 1000000;
+
+	io_uring_getevents_arg arg{};
+	arg.sigmask_sz = _NSIG / 8;
+	arg.ts = reinterpret_cast<u64>(&ts);
+
+	const bool use_timeout = timeout_ms >= 0 && m_ext_arg;
+
+	const int res = io_uring_enter(m_fd, m_to_submit, 1, IORING_ENTER_GETEVENTS | (use_timeout ? IORING_ENTER_EXT_ARG : 0), use_timeout ? &arg : nullptr, use_timeout ? sizeof(arg) : 0);
+
+	if (res >= 0)
+	{
+		m_to_submit -= std::min<u32>(res, m_to_submit);
+		return 0;
+	}
+
+	return errno == ETIME || errno == EINTR || errno == EBUSY ? 0 : -1;
+}
+
+void uring_t::put_buffer(u16 bid)
+{
+	// don't use m_br->bufs, its offset isn't zero in C++ (__DECLARE_FLEX_ARRAY adds an empty struct)
+	auto& buf = reinterpret_cast<io_uring_buf*>(m_br)[m_br_tail & (m_buf_count - 1)];
+	buf.addr = reinterpret_cast<u64>(get_buffer(bid));
+	buf.len = m_buf_size;
+	buf.bid = bid;
+
+	__atomic_store_n(&m_br->tail, ++m_br_tail, __ATOMIC_RELEASE);
+}
+
+#endif
@@ -0,0 +1,88 @@
+#pragma once
+#include "ep_defines.h"
+
+#ifdef HAVE_IO_URING
+
+#include <linux/io_uring.h>
+
+// Minimal io_uring wrapper (submission/completion rings and provided buffer ring)
+class uring_t final
+{
+	int m_fd = -1;
+
+	void* m_sq_ptr = nullptr;
+	std::size_t m_sq_size = 0;
+	void* m_cq_ptr = nullptr;
+	std::size_t m_cq_size = 0;
+	io_uring_sqe* m_sqes = nullptr;
+	std::size_t m_sqes_size = 0;
+
+	u32* m_sq_head = nullptr;
+	u32* m_sq_tail = nullptr;
+	u32* m_sq_array = nullptr;
+	u32 m_sq_mask = 0;
+	u32 m_sq_entries = 0;
+	u32 m_sq_local_tail = 0; // not yet published tail
+	u32 m_to_submit = 0;
+
+	u32* m_cq_head = nullptr;
+	u32* m_cq_tail = nullptr;
+	io_uring_cqe* m_cqes = nullptr;
+	u32 m_cq_mask = 0;
+
+	io_uring_buf_ring* m_br = nullptr; // provided buffer ring
+	std::size_t m_br_size = 0;
+	u8* m_buffers = nullptr;
+	u32 m_buf_count = 0;
+	u32 m_buf_size = 0;
+	u16 m_br_tail = 0;
+
+	bool m_ext_arg = false;
+
+public:
+	enum : u16
+	{
+		buffer_group = 0,
+	};
+
+	uring_t() = default;
+
+	uring_t(const uring_t&) = delete;
+
+	~uring_t();
+
+	// create rings and register buf_count buffers of buf_size bytes (buf_count must be a power of 2)
+	bool init(u32 entries, u32 buf_count, u32 buf_size);
+
+	// get new submission entry (submits pending entries if the ring is full)
+	io_uring_sqe* get_sqe();
+
+	// submit pending entries and wait for at least one completion (timeout_ms < 0 means infinite)
+	int submit_and_wait(int timeout_ms);
+
+	// process all available completions
+	template<typename F> void for_each_cqe(F func)
+	{
+		u32 head = *m_cq_head;
+
+		while (head != __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE))
+		{
+			const io_uring_cqe cqe = m_cqes[head & m_cq_mask];
+
+			__atomic_store_n(m_cq_head, ++head, __ATOMIC_RELEASE);
+
+			func(cqe);
+		}
+	}
+
+	// get provided buffer data
+	const u8* get_buffer(u16 bid) const
+	{
+		return m_buffers + std::size_t{ bid } * m_buf_size;
+	}
+
+	// return provided buffer to the ring
+	void put_buffer(u16 bid);
+};
+
+#endif
@@ -0,0 +1,256 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_worker.h"
+#include "ep_timer.h"
+
+worker_pool_t g_workers;
+worker_pool_t g_crypto;
+
+void worker_pool_t::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (!m_exit)
+	{
+		if (m_queue.empty())
+		{
+			m_cond.wait(lock);
+			continue;
+		}
+
+		const auto task = std::move(m_queue.front());
+		m_queue.pop();
+
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+
+	m_running--;
+	m_cond.notify_all();
+}
+
+void worker_pool_t::start(u32 count, std::size_t limit)
+{
+	m_limit = limit;
+	m_count = count;
+	m_running = count;
+
+	for (u32 i = 0; i < count; i++)
+	{
+		std::thread(&worker_pool_t::run, this).detach();
+	}
+}
+
+void worker_pool_t::stop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_exit = true;
+	m_cond.notify_all();
+
+	m_cond.wait(lock, [&]
+	{
+		return m_running == 0;
+	});
+}
+
+void worker_pool_t::post(std::function<void()> task)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_queue.emplace(std::move(task));
+	m_cond.notify_one();
+}
+
+bool worker_pool_t::try_post(std::function<void()> task)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_queue.size() >= m_limit)
+	{
+		return false;
+	}
+
+	m_queue.emplace(std::move(task));
+	m_cond.notify_one();
+	return true;
+}
+
+std::size_t worker_pool_t::pending()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_queue.size();
+}
+
+void worker_pool_t::post_delayed(std::function<void()> task, u32 delay_ms)
+{
+	g_timers.post([this, task]()
+	{
+		post(task);
+	}, delay_ms);
+}
+
+serial_executor_t::serial_executor_t(std::size_t limit)
+	: limit(limit)
+{
+}
+
+void serial_executor_t::run()
+{
+	// execute limited number of tasks and reschedule to not starve other executors
+	for (u32 i = 0; i < 16; i++)
+	{
+		task_t task;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			if (m_stopped || m_tasks.empty())
+			{
+				m_active = false;
+				return;
+			}
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+
+			m_cond.notify_one();
+
+			if (m_full && m_signal)
+			{
+				m_signal();
+			}
+
+			m_full = false;
+		}
+
+		u32 delay = 0;
+
+		if (!task(delay))
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			stop(lock);
+			m_active = false;
+			return;
+		}
+
+		if (delay)
+		{
+			const auto self = shared_from_this();
+
+			g_workers.post_delayed([self]()
+			{
+				self->run();
+			}, delay);
+
+			return;
+		}
+	}
+
+	const auto self = shared_from_this();
+
+	g_workers.post([self]()
+	{
+		self->run();
+	});
+}
+
+bool serial_executor_t::push(task_t task, bool wait)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (wait)
+	{
+		m_cond.wait(lock, [&]
+		{
+			return m_stopped || m_closed || m_tasks.size() < limit;
+		});
+	}
+
+	if (m_stopped || m_closed)
+	{
+		return false;
+	}
+
+	if (m_tasks.size() >= limit)
+	{
+		m_full = true;
+		return false;
+	}
+
+	m_tasks.emplace(std::move(task));
+	schedule();
+	return true;
+}
+
+bool serial_executor_t::close(task_t task)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_stopped || m_closed)
+	{
+		return false;
+	}
+
+	m_closed = true;
+	m_tasks.emplace(std::move(task));
+	schedule();
+	return true;
+}
+
+void serial_executor_t::schedule()
+{
+	if (!m_active)
+	{
+		m_active = true;
+
+		const auto self = shared_from_this();
+
+		g_workers.post([self]()
+		{
+			self->run();
+		});
+	}
+}
+
+void serial_executor_t::stop(std::unique_lock<std::mutex>&)
+{
+	if (!m_stopped)
+	{
+		m_stopped = true;
+
+		while (!m_tasks.empty())
+		{
+			m_tasks.pop();
+		}
+
+		m_cond.notify_all();
+
+		if (m_signal)
+		{
+			m_signal();
+		}
+	}
+}
+
+void serial_executor_t::stop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	stop(lock);
+}
+
+bool serial_executor_t::is_stopped()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_stopped;
+}
+
+void serial_executor_t::set_signal(std::function<void()> signal)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_signal = std::move(signal);
+}
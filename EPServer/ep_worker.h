@@ -0,0 +1,85 @@
+#pragma once
+#include "ep_defines.h"
+
+// Fixed-size thread pool
+class worker_pool_t final
+{
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::queue<std::function<void()>> m_queue;
+	std::size_t m_limit = SIZE_MAX; // max pending tasks for try_post()
+	u32 m_count = 0;
+	u32 m_running = 0; // started threads
+	bool m_exit = false;
+
+	void run();
+
+public:
+	// start worker threads
+	void start(u32 count, std::size_t limit = SIZE_MAX);
+
+	// stop worker threads (remaining tasks are discarded)
+	void stop();
+
+	u32 size() const
+	{
+		return m_count;
+	}
+
+	void post(std::function<void()> task);
+
+	// add task if the number of pending tasks is below the limit
+	bool try_post(std::function<void()> task);
+
+	// get number of pending tasks
+	std::size_t pending();
+
+	// execute task after delay_ms (uses g_timers)
+	void post_delayed(std::function<void()> task, u32 delay_ms);
+};
+
+extern worker_pool_t g_workers;
+extern worker_pool_t g_crypto; // handshake decryption
+
+// Bounded task queue executed sequentially in the worker pool
+class serial_executor_t final : public std::enable_shared_from_this<serial_executor_t>
+{
+public:
+	// task returns false to stop the executor and can set delay (ms) before the next task
+	using task_t = std::function<bool(u32& delay)>;
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::queue<task_t> m_tasks;
+	std::function<void()> m_signal; // called when free space appears after push() failed
+	bool m_active = false; // scheduled in the worker pool
+	bool m_stopped = false;
+	bool m_closed = false;
+	bool m_full = false;
+
+	void run();
+
+	void schedule();
+
+	// m_mutex must be locked
+	void stop(std::unique_lock<std::mutex>& lock);
+
+public:
+	const std::size_t limit;
+
+	serial_executor_t(std::size_t limit);
+
+	// add task (if wait is true, wait for free space), return false if stopped or full
+	bool push(task_t task, bool wait);
+
+	// add final task ignoring the limit (push() will fail), return false if stopped or already closed
+	bool close(task_t task);
+
+	// discard remaining tasks
+	void stop();
+
+	bool is_stopped();
+
+	void set_signal(std::function<void()> signal);
+};
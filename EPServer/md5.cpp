@@ -0,0 +1,310 @@
+#include "stdafx.h"
+#include "md5.h"
+
+#include <emmintrin.h>
+
+namespace
+{
+	// SIMD lanes (independent values, two vectors are interleaved to hide latency)
+	struct md5_vec_t
+	{
+		__m128i v[2];
+	};
+
+	inline md5_vec_t operator +(md5_vec_t a, md5_vec_t b)
+	{
+		return{ { _mm_add_epi32(a.v[0], b.v[0]), _mm_add_epi32(a.v[1], b.v[1]) } };
+	}
+
+	inline md5_vec_t operator +(md5_vec_t a, u32 b)
+	{
+		const __m128i k = _mm_set1_epi32(b);
+		return{ { _mm_add_epi32(a.v[0], k), _mm_add_epi32(a.v[1], k) } };
+	}
+
+	inline md5_vec_t operator &(md5_vec_t a, md5_vec_t b)
+	{
+		return{ { _mm_and_si128(a.v[0], b.v[0]), _mm_and_si128(a.v[1], b.v[1]) } };
+	}
+
+	inline md5_vec_t operator |(md5_vec_t a, md5_vec_t b)
+	{
+		return{ { _mm_or_si128(a.v[0], b.v[0]), _mm_or_si128(a.v[1], b.v[1]) } };
+	}
+
+	inline md5_vec_t operator ^(md5_vec_t a, md5_vec_t b)
+	{
+		return{ { _mm_xor_si128(a.v[0], b.v[0]), _mm_xor_si128(a.v[1], b.v[1]) } };
+	}
+
+	inline md5_vec_t operator ~(md5_vec_t a)
+	{
+		const __m128i m = _mm_set1_epi32(-1);
+		return{ { _mm_xor_si128(a.v[0], m), _mm_xor_si128(a.v[1], m) } };
+	}
+
+	template<u32 S> inline u32 rol(u32 v)
+	{
+		return v << S | v >> (32 - S);
+	}
+
+	template<u32 S> inline md5_vec_t rol(md5_vec_t v)
+	{
+		return{ {
+			_mm_or_si128(_mm_slli_epi32(v.v[0], S), _mm_srli_epi32(v.v[0], 32 - S)),
+			_mm_or_si128(_mm_slli_epi32(v.v[1], S), _mm_srli_epi32(v.v[1], 32 - S)),
+		} };
+	}
+
+	// round steps (shift and constant must be constants)
+	template<u32 S, u32 K, typename T> inline void ff(T& a, T b, T c, T d, T x)
+	{
+		a = b + rol<S>(a + (d ^ (b & (c ^ d))) + x + K);
+	}
+
+	template<u32 S, u32 K, typename T> inline void gg(T& a, T b, T c, T d, T x)
+	{
+		a = b + rol<S>(a + (c ^ (d & (b ^ c))) + x + K);
+	}
+
+	template<u32 S, u32 K, typename T> inline void hh(T& a, T b, T c, T d, T x)
+	{
+		a = b + rol<S>(a + (b ^ c ^ d) + x + K);
+	}
+
+	template<u32 S, u32 K, typename T> inline void ii(T& a, T b, T c, T d, T x)
+	{
+		a = b + rol<S>(a + (c ^ (b | ~d)) + x + K);
+	}
+
+	// process single block (T is u32 or md5_vec_t)
+	template<typename T> inline void transform(T* state, const T* x)
+	{
+		T a = state[0], b = state[1], c = state[2], d = state[3];
+
+		ff<7, 0xd76aa478>(a, b, c, d, x[0]);
+		ff<12, 0xe8c7b756>(d, a, b, c, x[1]);
+		ff<17, 0x242070db>(c, d, a, b, x[2]);
+		ff<22, 0xc1bdceee>(b, c, d, a, x[3]);
+		ff<7, 0xf57c0faf>(a, b, c, d, x[4]);
+		ff<12, 0x4787c62a>(d, a, b, c, x[5]);
+		ff<17, 0xa8304613>(c, d, a, b, x[6]);
+		ff<22, 0xfd469501>(b, c, d, a, x[7]);
+		ff<7, 0x698098d8>(a, b, c, d, x[8]);
+		ff<12, 0x8b44f7af>(d, a, b, c, x[9]);
+		ff<17, 0xffff5bb1>(c, d, a, b, x[10]);
+		ff<22, 0x895cd7be>(b, c, d, a, x[11]);
+		ff<7, 0x6b901122>(a, b, c, d, x[12]);
+		ff<12, 0xfd987193>(d, a, b, c, x[13]);
+		ff<17, 0xa679438e>(c, d, a, b, x[14]);
+		ff<22, 0x49b40821>(b, c, d, a, x[15]);
+
+		gg<5, 0xf61e2562>(a, b, c, d, x[1]);
+		gg<9, 0xc040b340>(d, a, b, c, x[6]);
+		gg<14, 0x265e5a51>(c, d, a, b, x[11]);
+		gg<20, 0xe9b6c7aa>(b, c, d, a, x[0]);
+		gg<5, 0xd62f105d>(a, b, c, d, x[5]);
+		gg<9, 0x02441453>(d, a, b, c, x[10]);
+		gg<14, 0xd8a1e681>(c, d, a, b, x[15]);
+		gg<20, 0xe7d3fbc8>(b, c, d, a, x[4]);
+		gg<5, 0x21e1cde6>(a, b, c, d, x[9]);
+		gg<9, 0xc33707d6>(d, a, b, c, x[14]);
+		gg<14, 0xf4d50d87>(c, d, a, b, x[3]);
+		gg<20, 0x455a14ed>(b, c, d, a, x[8]);
+		gg<5, 0xa9e3e905>(a, b, c, d, x[13]);
+		gg<9, 0xfcefa3f8>(d, a, b, c, x[2]);
+		gg<14, 0x676f02d9>(c, d, a, b, x[7]);
+		gg<20, 0x8d2a4c8a>(b, c, d, a, x[12]);
+
+		hh<4, 0xfffa3942>(a, b, c, d, x[5]);
+		hh<11, 0x8771f681>(d, a, b, c, x[8]);
+		hh<16, 0x6d9d6122>(c, d, a, b, x[11]);
+		hh<23, 0xfde5380c>(b, c, d, a, x[14]);
+		hh<4, 0xa4beea44>(a, b, c, d, x[1]);
+		hh<11, 0x4bdecfa9>(d, a, b, c, x[4]);
+		hh<16, 0xf6bb4b60>(c, d, a, b, x[7]);
+		hh<23, 0xbebfbc70>(b, c, d, a, x[10]);
+		hh<4, 0x289b7ec6>(a, b, c, d, x[13]);
+		hh<11, 0xeaa127fa>(d, a, b, c, x[0]);
+		hh<16, 0xd4ef3085>(c, d, a, b, x[3]);
+		hh<23, 0x04881d05>(b, c, d, a, x[6]);
+		hh<4, 0xd9d4d039>(a, b, c, d, x[9]);
+		hh<11, 0xe6db99e5>(d, a, b, c, x[12]);
+		hh<16, 0x1fa27cf8>(c, d, a, b, x[15]);
+		hh<23, 0xc4ac5665>(b, c, d, a, x[2]);
+
+		ii<6, 0xf4292244>(a, b, c, d, x[0]);
+		ii<10, 0x432aff97>(d, a, b, c, x[7]);
+		ii<15, 0xab9423a7>(c, d, a, b, x[14]);
+		ii<21, 0xfc93a039>(b, c, d, a, x[5]);
+		ii<6, 0x655b59c3>(a, b, c, d, x[12]);
+		ii<10, 0x8f0ccc92>(d, a, b, c, x[3]);
+		ii<15, 0xffeff47d>(c, d, a, b, x[10]);
+		ii<21, 0x85845dd1>(b, c, d, a, x[1]);
+		ii<6, 0x6fa87e4f>(a, b, c, d, x[8]);
+		ii<10, 0xfe2ce6e0>(d, a, b, c, x[15]);
+		ii<15, 0xa3014314>(c, d, a, b, x[6]);
+		ii<21, 0x4e0811a1>(b, c, d, a, x[13]);
+		ii<6, 0xf7537e82>(a, b, c, d, x[4]);
+		ii<10, 0xbd3af235>(d, a, b, c, x[11]);
+		ii<15, 0x2ad7d2bb>(c, d, a, b, x[2]);
+		ii<21, 0xeb86d391>(b, c, d, a, x[9]);
+
+		state[0] = state[0] + a;
+		state[1] = state[1] + b;
+		state[2] = state[2] + c;
+		state[3] = state[3] + d;
+	}
+
+	// swap rows and columns of 4x4 matrix of u32
+	inline void transpose(__m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3)
+	{
+		const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+		const __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+		const __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+		const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+		r0 = _mm_unpacklo_epi64(t0, t1);
+		r1 = _mm_unpackhi_epi64(t0, t1);
+		r2 = _mm_unpacklo_epi64(t2, t3);
+		r3 = _mm_unpackhi_epi64(t2, t3);
+	}
+
+	// process block of bytes (little-endian)
+	inline void transform_block(u32* state, const u8* block)
+	{
+		u32 x[16];
+		std::memcpy(x, block, 64);
+		transform(state, x);
+	}
+
+	const u32 md5_init[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+}
+
+md5_hasher_t::md5_hasher_t()
+{
+	reset();
+}
+
+md5_hasher_t::~md5_hasher_t()
+{
+	std::memset(m_buffer, 0, sizeof(m_buffer)); // burn
+}
+
+void md5_hasher_t::update(const void* data, std::size_t size)
+{
+	auto input = static_cast<const u8*>(data);
+	std::size_t pos = m_size % 64;
+
+	m_size += size;
+
+	// complete buffered block
+	if (pos)
+	{
+		const std::size_t part = std::min<std::size_t>(64 - pos, size);
+
+		std::memcpy(m_buffer + pos, input, part);
+		input += part;
+		size -= part;
+
+		if (pos + part < 64)
+		{
+			return;
+		}
+
+		transform_block(m_state, m_buffer);
+	}
+
+	// process whole blocks
+	for (; size >= 64; input += 64, size -= 64)
+	{
+		transform_block(m_state, input);
+	}
+
+	std::memcpy(m_buffer, input, size);
+}
+
+md5_t md5_hasher_t::finish()
+{
+	const u64 bits = m_size * 8;
+	const std::size_t pos = m_size % 64;
+
+	// append padding and size in bits
+	m_buffer[pos] = 0x80;
+	std::memset(m_buffer + pos + 1, 0, 63 - pos);
+
+	if (pos >= 56)
+	{
+		transform_block(m_state, m_buffer);
+		std::memset(m_buffer, 0, 56);
+	}
+
+	std::memcpy(m_buffer + 56, &bits, 8);
+	transform_block(m_state, m_buffer);
+
+	md5_t result;
+	std::memcpy(result.data(), m_state, 16);
+
+	return result;
+}
+
+void md5_hasher_t::reset()
+{
+	std::memcpy(m_state, md5_init, sizeof(m_state));
+	m_size = 0;
+}
+
+md5_t md5_hasher_t::hash(const void* data, std::size_t size)
+{
+	md5_hasher_t hasher;
+	hasher.update(data, size);
+	return hasher.finish();
+}
+
+void md5_hasher_t::hash_batch(const md5_t* input, md5_t* output, std::size_t count)
+{
+	// 16-byte message occupies single block: data, 0x80, zeros, size in bits
+	md5_vec_t x[16];
+
+	for (auto& v : x)
+	{
+		v.v[0] = v.v[1] = _mm_setzero_si128();
+	}
+
+	x[4].v[0] = x[4].v[1] = _mm_set1_epi32(0x80);
+	x[14].v[0] = x[14].v[1] = _mm_set1_epi32(128);
+
+	for (std::size_t i = 0; i < count; i += 8)
+	{
+		const std::size_t lanes = std::min<std::size_t>(count - i, 8);
+
+		__m128i rows[8]{};
+
+		for (std::size_t j = 0; j < lanes; j++)
+		{
+			rows[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input[i + j].data()));
+		}
+
+		transpose(rows[0], rows[1], rows[2], rows[3]);
+		transpose(rows[4], rows[5], rows[6], rows[7]);
+
+		md5_vec_t state[4];
+
+		for (u32 j = 0; j < 4; j++)
+		{
+			x[j].v[0] = rows[j];
+			x[j].v[1] = rows[j + 4];
+			state[j].v[0] = state[j].v[1] = _mm_set1_epi32(md5_init[j]);
+		}
+
+		transform(state, x);
+
+		transpose(state[0].v[0], state[1].v[0], state[2].v[0], state[3].v[0]);
+		transpose(state[0].v[1], state[1].v[1], state[2].v[1], state[3].v[1]);
+
+		for (std::size_t j = 0; j < lanes; j++)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output[i + j].data()), state[j % 4].v[j / 4]);
+		}
+	}
+}
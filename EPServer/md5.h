@@ -0,0 +1,28 @@
+#pragma once
+
+#include "ep_defines.h"
+
+// MD5 message digest (derived from the RSA Data Security, Inc. MD5 Message-Digest Algorithm, RFC 1321)
+class md5_hasher_t final
+{
+	u32 m_state[4];
+	u64 m_size = 0; // total data size
+	u8 m_buffer[64]; // incomplete block
+
+public:
+	md5_hasher_t();
+	~md5_hasher_t();
+
+	void update(const void* data, std::size_t size);
+
+	// get result (hasher must be reset before it can be used again)
+	md5_t finish();
+
+	void reset();
+
+	// hash contiguous data
+	static md5_t hash(const void* data, std::size_t size);
+
+	// hash independent 16-byte values (up to 8 values are processed in parallel in SIMD lanes)
+	static void hash_batch(const md5_t* input, md5_t* output, std::size_t count);
+};
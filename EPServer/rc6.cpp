@@ -1,6 +1,48 @@
 #include "stdafx.h"
 #include "rc6.h"
 
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+	u32 detect_lanes()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+
+		const int max_leaf = info[0];
+
+		__cpuid(info, 1);
+
+		const bool sse41 = (info[2] & (1 << 19)) != 0;
+		const bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6; // OS saves YMM registers
+
+		if (avx && max_leaf >= 7)
+		{
+			__cpuidex(info, 7, 0);
+
+			if (info[1] & (1 << 5))
+			{
+				return 8;
+			}
+		}
+
+		return sse41 ? 4 : 0;
+#else
+		__builtin_cpu_init();
+
+		return __builtin_cpu_supports("avx2") ? 8 : __builtin_cpu_supports("sse4.1") ? 4 : 0;
+#endif
+	}
+
+	u32 g_lanes = detect_lanes();
+}
+
 rc6_cipher_t::rc6_cipher_t(const packet_t& key)
 {
 	if (key->size != 16 && key->size != 32 && key->size != 64)
@@ -41,11 +83,8 @@ rc6_cipher_t::~rc6_cipher_t()
 	m_dec_last.clear();
 }
 
-void rc6_cipher_t::encrypt_block_cbc(rc6_block_t& block)
+void rc6_cipher_t::encrypt_block(cipher_block_t& block) const
 {
-	// CBC initialization
-	block.vi = _mm_xor_si128(block.vi, m_enc_last.vi);
-
 	block.i[1] += m_s[0];
 	block.i[3] += m_s[1];
 
@@ -61,13 +100,29 @@ void rc6_cipher_t::encrypt_block_cbc(rc6_block_t& block)
 
 	block.i[0] += m_s[rounds * 2 + 2];
 	block.i[2] += m_s[rounds * 2 + 3];
+}
+
+void rc6_cipher_t::encrypt_block_cbc(cipher_block_t& block)
+{
+	// CBC initialization
+	block.vi = _mm_xor_si128(block.vi, m_enc_last.vi);
+
+	encrypt_block(block);
 
 	m_enc_last = block;
 }
 
-void rc6_cipher_t::decrypt_block_cbc(rc6_block_t& block)
+void rc6_cipher_t::encrypt_cbc(cipher_block_t* blocks, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; i++)
+	{
+		encrypt_block_cbc(blocks[i]);
+	}
+}
+
+void rc6_cipher_t::decrypt_block_cbc(cipher_block_t& block)
 {
-	const rc6_block_t encrypted = block;
+	const cipher_block_t encrypted = block;
 
 	block.i[0] -= m_s[rounds * 2 + 2];
 	block.i[2] -= m_s[rounds * 2 + 3];
@@ -90,3 +145,270 @@ void rc6_cipher_t::decrypt_block_cbc(rc6_block_t& block)
 
 	m_dec_last = encrypted;
 }
+
+// SSE4.1 and AVX2 code is compiled for these instruction sets only (the kernel is selected at runtime)
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+#endif
+
+namespace rc6_sse41
+{
+	using rc6_vec_t = __m128i;
+
+	inline rc6_vec_t rol_var(rc6_vec_t v, rc6_vec_t s)
+	{
+		// multiply by 2^s (built from float exponent), 64-bit products contain both rotated parts
+		const __m128i p = _mm_cvttps_epi32(_mm_castsi128_ps(_mm_add_epi32(_mm_slli_epi32(_mm_and_si128(s, _mm_set1_epi32(31)), 23), _mm_set1_epi32(0x3f800000))));
+		const __m128i even = _mm_mul_epu32(v, p);
+		const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(v, 32), _mm_srli_epi64(p, 32));
+
+		return _mm_blend_epi16(_mm_or_si128(even, _mm_srli_epi64(even, 32)), _mm_or_si128(odd, _mm_slli_epi64(odd, 32)), 0xcc);
+	}
+
+	inline rc6_vec_t rol_5(rc6_vec_t v)
+	{
+		return _mm_or_si128(_mm_slli_epi32(v, 5), _mm_srli_epi32(v, 27));
+	}
+
+	inline rc6_vec_t f(rc6_vec_t v)
+	{
+		// rol32(v * (2 * v + 1), 5)
+		return rol_5(_mm_mullo_epi32(v, _mm_add_epi32(_mm_add_epi32(v, v), _mm_set1_epi32(1))));
+	}
+
+	// 4x4 transposition
+	inline void transpose(rc6_vec_t& a, rc6_vec_t& b, rc6_vec_t& c, rc6_vec_t& d)
+	{
+		const rc6_vec_t t0 = _mm_unpacklo_epi32(a, b);
+		const rc6_vec_t t1 = _mm_unpacklo_epi32(c, d);
+		const rc6_vec_t t2 = _mm_unpackhi_epi32(a, b);
+		const rc6_vec_t t3 = _mm_unpackhi_epi32(c, d);
+		a = _mm_unpacklo_epi64(t0, t1);
+		b = _mm_unpackhi_epi64(t0, t1);
+		c = _mm_unpacklo_epi64(t2, t3);
+		d = _mm_unpackhi_epi64(t2, t3);
+	}
+
+	inline rc6_vec_t load(const cipher_block_t* blocks, u32 i)
+	{
+		return blocks[i].vi;
+	}
+
+	inline void store(cipher_block_t* blocks, u32 i, rc6_vec_t v)
+	{
+		blocks[i].vi = v;
+	}
+
+	inline rc6_vec_t sub(rc6_vec_t a, u32 b)
+	{
+		return _mm_sub_epi32(a, _mm_set1_epi32(b));
+	}
+
+	inline rc6_vec_t neg(rc6_vec_t a)
+	{
+		return _mm_sub_epi32(_mm_setzero_si128(), a);
+	}
+
+	inline rc6_vec_t add(rc6_vec_t a, rc6_vec_t b)
+	{
+		return _mm_add_epi32(a, b);
+	}
+
+	inline rc6_vec_t add(rc6_vec_t a, u32 b)
+	{
+		return _mm_add_epi32(a, _mm_set1_epi32(b));
+	}
+
+	// load transposed key data
+	inline rc6_vec_t load_key(const u32* key)
+	{
+		return _mm_load_si128(reinterpret_cast<const rc6_vec_t*>(key));
+	}
+
+	inline rc6_vec_t xor_(rc6_vec_t a, rc6_vec_t b)
+	{
+		return _mm_xor_si128(a, b);
+	}
+}
+
+#define RC6_LANES 4
+#define RC6_SIMD rc6_sse41
+#include "rc6_simd.inl"
+#undef RC6_SIMD
+#undef RC6_LANES
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace rc6_avx2
+{
+	using rc6_vec_t = __m256i;
+
+	inline rc6_vec_t rol_var(rc6_vec_t v, rc6_vec_t s)
+	{
+		s = _mm256_and_si256(s, _mm256_set1_epi32(31));
+
+		return _mm256_or_si256(_mm256_sllv_epi32(v, s), _mm256_srlv_epi32(v, _mm256_sub_epi32(_mm256_set1_epi32(32), s)));
+	}
+
+	inline rc6_vec_t rol_5(rc6_vec_t v)
+	{
+		return _mm256_or_si256(_mm256_slli_epi32(v, 5), _mm256_srli_epi32(v, 27));
+	}
+
+	inline rc6_vec_t f(rc6_vec_t v)
+	{
+		// rol32(v * (2 * v + 1), 5)
+		return rol_5(_mm256_mullo_epi32(v, _mm256_add_epi32(_mm256_add_epi32(v, v), _mm256_set1_epi32(1))));
+	}
+
+	// 4x4 transposition in each 128-bit lane
+	inline void transpose(rc6_vec_t& a, rc6_vec_t& b, rc6_vec_t& c, rc6_vec_t& d)
+	{
+		const rc6_vec_t t0 = _mm256_unpacklo_epi32(a, b);
+		const rc6_vec_t t1 = _mm256_unpacklo_epi32(c, d);
+		const rc6_vec_t t2 = _mm256_unpackhi_epi32(a, b);
+		const rc6_vec_t t3 = _mm256_unpackhi_epi32(c, d);
+		a = _mm256_unpacklo_epi64(t0, t1);
+		b = _mm256_unpackhi_epi64(t0, t1);
+		c = _mm256_unpacklo_epi64(t2, t3);
+		d = _mm256_unpackhi_epi64(t2, t3);
+	}
+
+	// load blocks i and i + 4
+	inline rc6_vec_t load(const cipher_block_t* blocks, u32 i)
+	{
+		return _mm256_inserti128_si256(_mm256_castsi128_si256(blocks[i].vi), blocks[i + 4].vi, 1);
+	}
+
+	inline void store(cipher_block_t* blocks, u32 i, rc6_vec_t v)
+	{
+		blocks[i].vi = _mm256_castsi256_si128(v);
+		blocks[i + 4].vi = _mm256_extracti128_si256(v, 1);
+	}
+
+	inline rc6_vec_t sub(rc6_vec_t a, u32 b)
+	{
+		return _mm256_sub_epi32(a, _mm256_set1_epi32(b));
+	}
+
+	inline rc6_vec_t neg(rc6_vec_t a)
+	{
+		return _mm256_sub_epi32(_mm256_setzero_si256(), a);
+	}
+
+	inline rc6_vec_t add(rc6_vec_t a, rc6_vec_t b)
+	{
+		return _mm256_add_epi32(a, b);
+	}
+
+	inline rc6_vec_t add(rc6_vec_t a, u32 b)
+	{
+		return _mm256_add_epi32(a, _mm256_set1_epi32(b));
+	}
+
+	// load transposed key data
+	inline rc6_vec_t load_key(const u32* key)
+	{
+		return _mm256_load_si256(reinterpret_cast<const rc6_vec_t*>(key));
+	}
+
+	inline rc6_vec_t xor_(rc6_vec_t a, rc6_vec_t b)
+	{
+		return _mm256_xor_si256(a, b);
+	}
+}
+
+#define RC6_LANES 8
+#define RC6_SIMD rc6_avx2
+#include "rc6_simd.inl"
+#undef RC6_SIMD
+#undef RC6_LANES
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+u32 rc6_cipher_t::get_lanes()
+{
+	return g_lanes;
+}
+
+u32 rc6_cipher_t::set_lanes(u32 lanes)
+{
+	const u32 supported = detect_lanes();
+
+	return g_lanes = lanes >= 8 && supported >= 8 ? 8 : lanes >= 4 && supported >= 4 ? 4 : 0;
+}
+
+void rc6_cipher_t::decrypt_cbc(cipher_block_t* blocks, std::size_t count)
+{
+	std::size_t done = 0;
+
+	switch (g_lanes)
+	{
+	case 8: done = decrypt_cbc_simd<8>(blocks, count); break;
+	case 4: done = decrypt_cbc_simd<4>(blocks, count); break;
+	}
+
+	for (std::size_t i = done; i < count; i++)
+	{
+		decrypt_block_cbc(blocks[i]);
+	}
+}
+
+void rc6_cipher_t::encrypt_cbc_batch(const cipher_job_t* jobs, std::size_t count)
+{
+	std::size_t next = 0; // next job
+
+	switch (g_lanes)
+	{
+	case 8: next = encrypt_cbc_batch_simd<8>(jobs, count); break;
+	case 4: next = encrypt_cbc_batch_simd<4>(jobs, count); break;
+	}
+
+	for (; next < count; next++)
+	{
+		if (jobs[next].count && jobs[next].cipher->get_type() == SECURE_RC6)
+		{
+			jobs[next].cipher->encrypt_cbc(jobs[next].blocks, jobs[next].count);
+		}
+	}
+}
+
+void rc6_cipher_t::make_keystream(cipher_block_t* blocks, std::size_t count, u64 counter, u32 stream) const
+{
+	// counter blocks
+	for (std::size_t i = 0; i < count; i++)
+	{
+		blocks[i].i[0] = static_cast<u32>(counter + i);
+		blocks[i].i[1] = static_cast<u32>((counter + i) >> 32);
+		blocks[i].i[2] = stream;
+		blocks[i].i[3] = 0;
+	}
+
+	std::size_t done = 0;
+
+	switch (g_lanes)
+	{
+	case 8: done = make_keystream_simd<8>(blocks, count); break;
+	case 4: done = make_keystream_simd<4>(blocks, count); break;
+	}
+
+	for (std::size_t i = done; i < count; i++)
+	{
+		encrypt_block(blocks[i]);
+	}
+}
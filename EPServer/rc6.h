@@ -1,32 +1,8 @@
 #pragma once
 
-#include <emmintrin.h>
-#include "ep_defines.h"
+#include "cipher.h"
 
-union rc6_block_t
-{
-	u32 i[4];
-	__m128i vi;
-
-	// Attempt to fix heap allocation alignment on x86 version (disabled):
-	
-	//void* operator new[](std::size_t size)
-	//{
-	//	return _mm_malloc(size, __alignof(rc6_block_t));
-	//}
-
-	//void operator delete[](void* p)
-	//{
-	//	return _mm_free(p);
-	//}
-
-	void clear()
-	{
-		vi = _mm_setzero_si128();
-	}
-};
-
-class rc6_cipher_t final
+class rc6_cipher_t final : public cipher_t
 {
 	enum : u32
 	{
@@ -41,13 +17,42 @@ class rc6_cipher_t final
 
 	std::array<u32, keylen> m_s; // key data
 
-	rc6_block_t m_enc_last;
-	rc6_block_t m_dec_last;
+	cipher_block_t m_enc_last;
+	cipher_block_t m_dec_last;
+
+	// SIMD kernels for 4 lanes (SSE4.1) and 8 lanes (AVX2), return the number of processed blocks (or jobs)
+	template<u32 Lanes> std::size_t decrypt_cbc_simd(cipher_block_t* blocks, std::size_t count);
+	template<u32 Lanes> std::size_t make_keystream_simd(cipher_block_t* blocks, std::size_t count) const;
+	template<u32 Lanes> static std::size_t encrypt_cbc_batch_simd(const cipher_job_t* jobs, std::size_t count);
 
 public:
 	rc6_cipher_t(const packet_t& key);
-	~rc6_cipher_t();
+	virtual ~rc6_cipher_t() override;
+
+	virtual SecureCipherType get_type() const override
+	{
+		return SECURE_RC6;
+	}
+
+	// encrypt single block (without chaining)
+	void encrypt_block(cipher_block_t& block) const;
+
+	void encrypt_block_cbc(cipher_block_t& block);
+	void decrypt_block_cbc(cipher_block_t& block);
+
+	virtual void encrypt_cbc(cipher_block_t* blocks, std::size_t count) override;
+
+	// decrypt multiple blocks (several blocks are processed in parallel if SIMD lanes are available)
+	virtual void decrypt_cbc(cipher_block_t* blocks, std::size_t count) override;
+
+	virtual void make_keystream(cipher_block_t* blocks, std::size_t count, u64 counter, u32 stream) const override;
+
+	// encrypt blocks of independent ciphers (each SIMD lane processes a separate cipher, which may appear only once; jobs of other ciphers are skipped)
+	static void encrypt_cbc_batch(const cipher_job_t* jobs, std::size_t count);
+
+	// get number of SIMD lanes (8 if AVX2 is supported by CPU, 4 if SSE4.1 is supported, 0 otherwise)
+	static u32 get_lanes();
 
-	void encrypt_block_cbc(rc6_block_t& block);
-	void decrypt_block_cbc(rc6_block_t& block);
+	// limit SIMD lanes (used by tests and benchmarks before any cipher is used), returns the new value
+	static u32 set_lanes(u32 lanes);
 };
@@ -0,0 +1,214 @@
+// SIMD kernels of rc6_cipher_t (included by rc6.cpp for each instruction set: RC6_SIMD namespace contains vector operations for RC6_LANES lanes)
+
+template<> std::size_t rc6_cipher_t::decrypt_cbc_simd<RC6_LANES>(cipher_block_t* blocks, std::size_t count)
+{
+	using namespace RC6_SIMD;
+
+	const std::size_t total = count;
+
+	cipher_block_t encrypted[RC6_LANES];
+
+	// decrypt independent blocks in parallel (one block per lane)
+	for (; count >= RC6_LANES; count -= RC6_LANES, blocks += RC6_LANES)
+	{
+		std::memcpy(encrypted, blocks, sizeof(encrypted));
+
+		// each vector contains the same word of all blocks
+		rc6_vec_t a = load(blocks, 0);
+		rc6_vec_t b = load(blocks, 1);
+		rc6_vec_t c = load(blocks, 2);
+		rc6_vec_t d = load(blocks, 3);
+		transpose(a, b, c, d);
+
+		a = sub(a, m_s[rounds * 2 + 2]);
+		c = sub(c, m_s[rounds * 2 + 3]);
+
+		for (u32 i = rounds; i; i--)
+		{
+			// rotate words
+			const rc6_vec_t x = d;
+			d = c;
+			c = b;
+			b = a;
+			a = x;
+
+			const rc6_vec_t t = f(b);
+			const rc6_vec_t u = f(d);
+			a = xor_(rol_var(sub(a, m_s[i * 2]), neg(u)), t);
+			c = xor_(rol_var(sub(c, m_s[i * 2 + 1]), neg(t)), u);
+		}
+
+		b = sub(b, m_s[0]);
+		d = sub(d, m_s[1]);
+
+		transpose(a, b, c, d);
+		store(blocks, 0, a);
+		store(blocks, 1, b);
+		store(blocks, 2, c);
+		store(blocks, 3, d);
+
+		// CBC finalization
+		blocks[0].vi = _mm_xor_si128(blocks[0].vi, m_dec_last.vi);
+
+		for (u32 i = 1; i < RC6_LANES; i++)
+		{
+			blocks[i].vi = _mm_xor_si128(blocks[i].vi, encrypted[i - 1].vi);
+		}
+
+		m_dec_last = encrypted[RC6_LANES - 1];
+	}
+
+	return total - count;
+}
+
+template<> std::size_t rc6_cipher_t::encrypt_cbc_batch_simd<RC6_LANES>(const cipher_job_t* jobs, std::size_t count)
+{
+	using namespace RC6_SIMD;
+
+	std::size_t next = 0; // next job
+
+	alignas(32) u32 keys[keylen][RC6_LANES]; // key data of all lanes
+	cipher_job_t lanes[RC6_LANES]; // current jobs (count is the number of remaining blocks)
+	cipher_block_t data[RC6_LANES];
+	u32 active = 0;
+
+	// start next job in the lane
+	const auto assign = [&](u32 lane)
+	{
+		while (next < count && (!jobs[next].count || jobs[next].cipher->get_type() != SECURE_RC6))
+		{
+			next++;
+		}
+
+		if (next == count)
+		{
+			lanes[lane] = {};
+			return;
+		}
+
+		lanes[lane] = jobs[next++];
+		active++;
+
+		for (u32 i = 0; i < keylen; i++)
+		{
+			keys[i][lane] = static_cast<rc6_cipher_t*>(lanes[lane].cipher)->m_s[i];
+		}
+	};
+
+	for (u32 lane = 0; lane < RC6_LANES; lane++)
+	{
+		assign(lane);
+	}
+
+	// use SIMD while at least two streams are available
+	while (active >= 2)
+	{
+		for (u32 lane = 0; lane < RC6_LANES; lane++)
+		{
+			if (lanes[lane].count)
+			{
+				// CBC initialization
+				data[lane].vi = _mm_xor_si128(lanes[lane].blocks->vi, static_cast<rc6_cipher_t*>(lanes[lane].cipher)->m_enc_last.vi);
+			}
+		}
+
+		rc6_vec_t a = load(data, 0);
+		rc6_vec_t b = load(data, 1);
+		rc6_vec_t c = load(data, 2);
+		rc6_vec_t d = load(data, 3);
+		transpose(a, b, c, d);
+
+		b = add(b, load_key(keys[0]));
+		d = add(d, load_key(keys[1]));
+
+		for (u32 i = 1; i <= rounds; i++)
+		{
+			const rc6_vec_t t = f(b);
+			const rc6_vec_t u = f(d);
+			const rc6_vec_t x = add(rol_var(xor_(a, t), u), load_key(keys[i * 2]));
+			a = b;
+			b = add(rol_var(xor_(c, u), t), load_key(keys[i * 2 + 1]));
+			c = d;
+			d = x;
+		}
+
+		a = add(a, load_key(keys[rounds * 2 + 2]));
+		c = add(c, load_key(keys[rounds * 2 + 3]));
+
+		transpose(a, b, c, d);
+		store(data, 0, a);
+		store(data, 1, b);
+		store(data, 2, c);
+		store(data, 3, d);
+
+		for (u32 lane = 0; lane < RC6_LANES; lane++)
+		{
+			auto& job = lanes[lane];
+
+			if (job.count)
+			{
+				*job.blocks++ = data[lane];
+				static_cast<rc6_cipher_t*>(job.cipher)->m_enc_last = data[lane];
+
+				if (!--job.count)
+				{
+					active--;
+					assign(lane);
+				}
+			}
+		}
+	}
+
+	// finish the remaining stream
+	for (const auto& job : lanes)
+	{
+		if (job.count)
+		{
+			job.cipher->encrypt_cbc(job.blocks, job.count);
+		}
+	}
+
+	return next;
+}
+
+template<> std::size_t rc6_cipher_t::make_keystream_simd<RC6_LANES>(cipher_block_t* blocks, std::size_t count) const
+{
+	using namespace RC6_SIMD;
+
+	const std::size_t total = count;
+
+	// encrypt independent blocks in parallel (one block per lane)
+	for (; count >= RC6_LANES; count -= RC6_LANES, blocks += RC6_LANES)
+	{
+		rc6_vec_t a = load(blocks, 0);
+		rc6_vec_t b = load(blocks, 1);
+		rc6_vec_t c = load(blocks, 2);
+		rc6_vec_t d = load(blocks, 3);
+		transpose(a, b, c, d);
+
+		b = add(b, m_s[0]);
+		d = add(d, m_s[1]);
+
+		for (u32 i = 1; i <= rounds; i++)
+		{
+			const rc6_vec_t t = f(b);
+			const rc6_vec_t u = f(d);
+			const rc6_vec_t x = add(rol_var(xor_(a, t), u), m_s[i * 2]);
+			a = b;
+			b = add(rol_var(xor_(c, u), t), m_s[i * 2 + 1]);
+			c = d;
+			d = x;
+		}
+
+		a = add(a, m_s[rounds * 2 + 2]);
+		c = add(c, m_s[rounds * 2 + 3]);
+
+		transpose(a, b, c, d);
+		store(blocks, 0, a);
+		store(blocks, 1, b);
+		store(blocks, 2, c);
+		store(blocks, 3, d);
+	}
+
+	return total - count;
+}
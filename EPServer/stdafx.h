@@ -17,10 +17,16 @@
 #include <memory>
 #include <vector>
 #include <queue>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <tuple>
+#include <chrono>
 #include <thread>
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <future>
 #include <algorithm>
 
 // C++ Format Library https://github.com/cppformat/cppformat
@@ -63,6 +69,12 @@ template<typename... T> inline void ep_printf(const char* fmt, const T&... args)
 	fmt::print(fmt, args...);
 }
 
+// Get monotonic time in milliseconds
+inline u64 get_time_ms()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 inline u32 rol32(u32 v, u32 s)
 {
 	return (v << s) | (v >> (32 - s));
@@ -0,0 +1,75 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "rc6.h"
+#include "aes.h"
+
+// RC6 and AES throughput for small (64 bytes) and large (64 KB) messages
+// Usage: bench_cipher [megabytes per test]
+
+namespace
+{
+	packet_t make_key(u32 size)
+	{
+		packet_t key(size);
+
+		for (u32 i = 0; i < size; i++)
+		{
+			key->get<u8>(i) = static_cast<u8>(i * 7 + 1);
+		}
+
+		return key;
+	}
+
+	void run(const char* name, cipher_t& cipher, u64 megabytes, std::size_t message)
+	{
+		std::vector<cipher_block_t> data(message / 16);
+
+		const u64 calls = std::max<u64>((megabytes << 20) / message, 1);
+
+		for (bool decrypt : { false, true })
+		{
+			const auto start = std::chrono::steady_clock::now();
+
+			for (u64 i = 0; i < calls; i++)
+			{
+				if (decrypt)
+				{
+					cipher.decrypt_cbc(data.data(), data.size());
+				}
+				else
+				{
+					cipher.encrypt_cbc(data.data(), data.size());
+				}
+			}
+
+			const f64 elapsed = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+			fmt::print("{:<6} {:>6} bytes {:<8} {:>8.1f} MB/s\n", name, message, decrypt ? "decrypt" : "encrypt", calls * message / elapsed / (1 << 20));
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const u64 megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+
+	fmt::print("{} MB per test, RC6 uses {} SIMD lanes\n", megabytes, rc6_cipher_t::get_lanes());
+
+	rc6_cipher_t rc6(make_key(16));
+
+	run("RC6", rc6, megabytes, 64);
+	run("RC6", rc6, megabytes, 0x10000);
+
+	if (!aes_cipher_t::is_supported())
+	{
+		fmt::print("AES-NI is not supported\n");
+		return 0;
+	}
+
+	aes_cipher_t aes(make_key(32));
+
+	run("AES", aes, megabytes, 64);
+	run("AES", aes, megabytes, 0x10000);
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_rsa.h"
+
+// RSA handshake decryption: full-size exponentiation with byte loops (previous code) and CRT with mpz_import/mpz_export (rsa_decrypt)
+// Usage: bench_handshake [key bits] [handshakes]
+
+namespace
+{
+	mpz_class make_prime(gmp_randclass& rng, u32 bits)
+	{
+		mpz_class result = rng.get_z_bits(bits);
+		mpz_setbit(result.get_mpz_t(), bits - 1);
+		mpz_nextprime(result.get_mpz_t(), result.get_mpz_t());
+		return result;
+	}
+
+	// computed as in main() from key.dat values
+	rsa_key_t make_key(gmp_randclass& rng, u32 bits)
+	{
+		rsa_key_t key;
+
+		do
+		{
+			key.set(65537, make_prime(rng, bits / 2), make_prime(rng, bits / 2));
+		}
+		while (key.p == key.q || key.d * 65537 % ((key.p - 1) * (key.q - 1)) != 1);
+
+		return key;
+	}
+
+	// previous code: full-size exponentiation, result is right-aligned
+	packet_t decrypt_full(const rsa_key_t& key, const packet_t& auth_info)
+	{
+		mpz_class num;
+
+		for (u32 i = 0; i < key.size; i++)
+		{
+			num <<= 8;
+			num += auth_info->get<u8>(i);
+		}
+
+		mpz_powm(num.get_mpz_t(), num.get_mpz_t(), key.d.get_mpz_t(), key.n.get_mpz_t());
+
+		packet_t result(key.size);
+
+		for (u32 i = key.size - 1; ~i; i--)
+		{
+			result->get<u8>(i) = static_cast<u8>(num.get_ui());
+			num >>= 8;
+		}
+
+		return result;
+	}
+
+	// copy of auth data (rsa_decrypt() works in place)
+	packet_t copy(const packet_t& data)
+	{
+		return { &data->get(), data->size };
+	}
+
+	mpz_class to_number(const packet_t& data)
+	{
+		mpz_class result;
+		mpz_import(result.get_mpz_t(), data->size, 1, 1, 1, 0, data->data());
+		return result;
+	}
+
+	template<typename F> f64 run(const char* name, u32 count, F func)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		for (u32 i = 0; i < count; i++)
+		{
+			func();
+		}
+
+		const f64 elapsed = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+		fmt::print("{:<24} {:>8.1f} us/handshake {:>8.0f} handshakes/s\n", name, elapsed * 1e6 / count, count / elapsed);
+
+		return elapsed;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const u32 bits = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2048;
+	const u32 count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+
+	gmp_randclass rng(gmp_randinit_default);
+
+	const rsa_key_t key = make_key(rng, bits);
+
+	// encrypted auth data (SecureAuthRec size is much smaller than the key)
+	const mpz_class message = rng.get_z_bits(bits / 2);
+	mpz_class encrypted;
+	mpz_powm_ui(encrypted.get_mpz_t(), message.get_mpz_t(), 65537, key.n.get_mpz_t());
+
+	packet_t auth_info(key.size);
+	std::memset(auth_info->data(), 0, key.size);
+	mpz_export(&auth_info->get(key.size - mpz_sizeinbase(encrypted.get_mpz_t(), 256)), nullptr, 1, 1, 1, 0, encrypted.get_mpz_t());
+
+	const packet_t full = decrypt_full(key, auth_info);
+	const packet_t crt = rsa_decrypt(key, copy(auth_info));
+
+	// rsa_decrypt() removes leading zeros
+	if (!crt || to_number(full) != to_number(crt))
+	{
+		fmt::print("decryption results differ\n");
+		return 1;
+	}
+
+	fmt::print("{}-bit key, {} handshakes\n", bits, count);
+
+	const f64 before = run("full exponent", count, [&]() { decrypt_full(key, auth_info); });
+	const f64 after = run("CRT, import/export", count, [&]() { rsa_decrypt(key, copy(auth_info)); });
+
+	fmt::print("speedup: {:.2f}x\n", before / after);
+
+	return 0;
+}
@@ -0,0 +1,174 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_listener.h"
+#include "ep_broadcast.h"
+
+// Broadcast fan-out benchmark: 1000 listeners, 8 broadcasting threads, consumers drain the queues concurrently
+// Usage: bench_listener [broadcasts per thread]
+
+namespace
+{
+	const u32 listener_count = 1000;
+	const u32 producer_count = 8;
+	const u32 consumer_count = 4;
+
+	// queue with mutex and condition variable (the previous listener_t implementation)
+	class mutex_queue_t
+	{
+		std::mutex m_mutex;
+		std::condition_variable m_cond;
+		std::vector<packet_t> m_queue;
+
+	public:
+		void push_packet(packet_t packet)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			m_queue.emplace_back(std::move(packet));
+			m_cond.notify_one();
+		}
+
+		bool try_pop_all(std::vector<packet_t>& packets)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			packets.swap(m_queue);
+			return !packets.empty();
+		}
+	};
+
+	// broadcast lock taken around the fan-out (the previous player_list_t::broadcast)
+	struct global_lock_t
+	{
+		std::mutex mutex;
+		const bool enabled;
+	};
+
+	template<typename T> T* create()
+	{
+		return new T();
+	}
+
+	template<> listener_t* create<listener_t>()
+	{
+		return new listener_t(0, 0, false);
+	}
+
+	template<typename T> void attach(T&, player_t*)
+	{
+	}
+
+	template<> void attach<listener_t>(listener_t& listener, player_t* player)
+	{
+		listener.attach(player);
+	}
+
+	template<typename T> void run(const char* name, u32 broadcasts, global_lock_t& global, bool ring = false)
+	{
+		static char player; // never dereferenced (broadcast packets have no filter)
+
+		std::vector<std::unique_ptr<T>> queues;
+
+		for (u32 i = 0; i < listener_count; i++)
+		{
+			queues.emplace_back(create<T>());
+			attach(*queues.back(), reinterpret_cast<player_t*>(&player));
+		}
+
+		std::atomic<bool> done{ false };
+		std::atomic<u64> received{ 0 };
+		std::vector<std::thread> consumers;
+
+		for (u32 c = 0; c < consumer_count; c++)
+		{
+			consumers.emplace_back([&, c]()
+			{
+				std::vector<packet_t> packets;
+
+				while (!done.load())
+				{
+					for (u32 i = c; i < listener_count; i += consumer_count)
+					{
+						if (queues[i]->try_pop_all(packets))
+						{
+							received += packets.size();
+							packets.clear();
+						}
+					}
+				}
+			});
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+
+		std::vector<std::thread> producers;
+
+		for (u32 p = 0; p < producer_count; p++)
+		{
+			producers.emplace_back([&]()
+			{
+				const packet_t packet = ServerTextRec::make(0, "benchmark message");
+
+				for (u32 b = 0; b < broadcasts; b++)
+				{
+					std::unique_lock<std::mutex> lock(global.mutex, std::defer_lock);
+
+					if (global.enabled)
+					{
+						lock.lock();
+					}
+
+					// push to every queue or publish once to the broadcast ring (listeners are attached)
+					if (ring)
+					{
+						g_broadcast.publish(packet);
+						continue;
+					}
+
+					for (auto& queue : queues)
+					{
+						queue->push_packet(packet);
+					}
+				}
+			});
+		}
+
+		for (auto& thread : producers)
+		{
+			thread.join();
+		}
+
+		const f64 elapsed = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+		const u64 pushes = u64{ producer_count } * broadcasts * listener_count;
+
+		done = true;
+
+		for (auto& thread : consumers)
+		{
+			thread.join();
+		}
+
+		fmt::print("{:<28} {:>8.1f} us/broadcast {:>6.2f} Mpush/s\n", name, elapsed * 1e6 / (u64{ producer_count } * broadcasts), pushes / elapsed / 1e6);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const u32 broadcasts = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+
+	g_queue_limit = 0;
+	g_queue_size_limit = 0;
+
+	fmt::print("{} listeners, {} broadcasting threads, {} broadcasts per thread\n", listener_count, producer_count, broadcasts);
+
+	global_lock_t locked{ {}, true };
+	global_lock_t unlocked{ {}, false };
+
+	run<mutex_queue_t>("mutex queue, global lock", broadcasts, locked);
+	run<mutex_queue_t>("mutex queue", broadcasts, unlocked);
+	run<listener_t>("listener_t, global lock", broadcasts, locked);
+	run<listener_t>("listener_t", broadcasts, unlocked);
+	run<listener_t>("broadcast ring", broadcasts, unlocked, true);
+
+	return 0;
+}
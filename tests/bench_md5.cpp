@@ -0,0 +1,80 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "md5.h"
+
+// MD5 speed for 16-byte values (password hashes) one by one and in batches, and for large data
+// Usage: bench_md5 [millions of hashes]
+
+namespace
+{
+	u32 g_sink = 0; // results are used so the calls can't be removed
+
+	template<typename F> void run(const char* name, u64 count, F func)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		func();
+
+		const f64 elapsed = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+		fmt::print("{:<28} {:>8.1f} ns/hash {:>8.1f} Mhash/s\n", name, elapsed * 1e9 / count, count / elapsed / 1e6);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const u64 count = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4) * 1000000;
+
+	md5_t value{};
+
+	run("hash 16 bytes", count, [&]()
+	{
+		for (u64 i = 0; i < count; i++)
+		{
+			value[0] = static_cast<u8>(i);
+			value = md5_hasher_t::hash(value.data(), value.size());
+		}
+
+		g_sink += value[0];
+	});
+
+	for (std::size_t batch : { 4, 8, 64 })
+	{
+		std::vector<md5_t> input(batch), output(batch);
+
+		for (std::size_t i = 0; i < batch; i++)
+		{
+			input[i][0] = static_cast<u8>(i);
+		}
+
+		run(fmt::format("hash_batch {} x 16 bytes", batch).c_str(), count / batch * batch, [&]()
+		{
+			for (u64 i = 0; i < count / batch; i++)
+			{
+				md5_hasher_t::hash_batch(input.data(), output.data(), batch);
+				input.swap(output);
+			}
+
+			g_sink += input[0][0];
+		});
+	}
+
+	// 64 KB blocks (count is the number of MD5 blocks)
+	std::vector<u8> data(0x10000);
+	md5_hasher_t hasher;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (u64 i = 0; i < count / (data.size() / 64); i++)
+	{
+		hasher.update(data.data(), data.size());
+	}
+
+	g_sink += hasher.finish()[0];
+
+	const f64 elapsed = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+	fmt::print("{:<28} {:>8.1f} MB/s\n", "update 64 KB", count / (data.size() / 64) * data.size() / elapsed / (1 << 20));
+
+	return g_sink == 0x12345678;
+}
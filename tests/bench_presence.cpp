@@ -0,0 +1,128 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_account.h"
+#include "ep_player.h"
+#include "ep_listener.h"
+
+#include <random>
+
+// only_online broadcast to 1000 registered players, 100 online (10 more connected with PF_OFF flag), every connection drains its queue
+// Compares the player table walk with account flags (previous player_list_t::broadcast) and the broadcast ring with only_online()
+// Usage: bench_presence [thousands of broadcasts]
+
+player_list_t g_players;
+
+namespace
+{
+	const u32 registered_count = 1000;
+	const u32 hole_count = 50; // removed players
+	const u32 online_count = 100;
+	const u32 hidden_count = 10;
+
+	// previous filter
+	bool not_hidden(player_t& player)
+	{
+		return (player.account->flags & PF_OFF) == 0;
+	}
+
+	template<typename F> void run(const char* name, u64 count, const std::vector<std::shared_ptr<listener_t>>& listeners, F func)
+	{
+		std::vector<packet_t> packets;
+
+		u64 received = 0;
+
+		const auto start = std::chrono::steady_clock::now();
+
+		for (u64 i = 0; i < count; i++)
+		{
+			func();
+
+			for (const auto& listener : listeners)
+			{
+				listener->try_pop_all(packets);
+				received += packets.size();
+				packets.clear();
+			}
+		}
+
+		const f64 elapsed = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+		fmt::print("{:<28} {:>8.1f} ns/broadcast {:>6} recipients\n", name, elapsed * 1e9 / count, received / count);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const u64 count = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200) * 1000;
+
+	std::vector<std::shared_ptr<player_t>> table; // copy of the player table (with holes)
+	std::vector<std::shared_ptr<listener_t>> listeners;
+
+	for (u32 i = 0; i < registered_count + hole_count; i++)
+	{
+		table.emplace_back(g_players.add_player(std::make_shared<account_t>()));
+
+		// half of the disconnected players are hidden
+		table.back()->account->flags = i % 2 ? u64{ PF_OFF } : 0;
+	}
+
+	// every 21st slot is a hole
+	for (u32 i = 20; i < table.size(); i += 21)
+	{
+		g_players.remove_player(i);
+		table[i].reset();
+	}
+
+	std::vector<u32> order;
+
+	for (u32 i = 0; i < table.size(); i++)
+	{
+		if (table[i])
+		{
+			order.emplace_back(i);
+		}
+	}
+
+	std::shuffle(order.begin(), order.end(), std::mt19937());
+
+	// connect online and hidden players at random slots
+	for (u32 i = 0; i < online_count + hidden_count; i++)
+	{
+		const auto& player = table[order[i]];
+
+		player->account->flags = i < online_count ? 0 : u64{ PF_OFF };
+
+		listeners.emplace_back(std::make_shared<listener_t>(0, 0, false));
+		player->add_listener(listeners.back());
+	}
+
+	g_queue_limit = 0;
+	g_queue_size_limit = 0;
+
+	std::string info;
+	g_players.append_stats(info);
+
+	fmt::print("{}, {} connected, {} broadcasts\n", info.substr(1), listeners.size(), count);
+
+	const packet_t packet = ServerTextRec::make(0, "benchmark message");
+
+	// every slot is checked, the packet is pushed to each connection of passing players
+	run("table walk, account flags", count, listeners, [&]()
+	{
+		for (const auto& player : table)
+		{
+			if (player && not_hidden(*player))
+			{
+				player->broadcast(packet);
+			}
+		}
+	});
+
+	// published once, only_online() is evaluated by each connection
+	run("broadcast ring, only_online", count, listeners, [&]()
+	{
+		g_players.broadcast(packet, only_online);
+	});
+
+	return 0;
+}
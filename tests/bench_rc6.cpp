@@ -0,0 +1,86 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "rc6.h"
+
+// RC6 throughput with scalar code and each supported SIMD lane count
+// Usage: bench_rc6 [megabytes per test]
+
+namespace
+{
+	packet_t make_key()
+	{
+		packet_t key(16);
+
+		for (u32 i = 0; i < 16; i++)
+		{
+			key->get<u8>(i) = static_cast<u8>(i * 7 + 1);
+		}
+
+		return key;
+	}
+
+	// call func(blocks) until the specified amount of data is processed
+	template<typename F> void run(const char* name, u32 lanes, u64 megabytes, std::size_t blocks, F func)
+	{
+		const u64 calls = std::max<u64>((megabytes << 20) / (blocks * 16), 1);
+
+		const auto start = std::chrono::steady_clock::now();
+
+		for (u64 i = 0; i < calls; i++)
+		{
+			func();
+		}
+
+		const f64 elapsed = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+		fmt::print("{:<28} {} lanes {:>8.1f} MB/s\n", name, lanes, calls * blocks * 16 / elapsed / (1 << 20));
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const u64 megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+
+	fmt::print("CPU supports {} lanes, {} MB per test\n", rc6_cipher_t::get_lanes(), megabytes);
+
+	for (u32 lanes : { 0, 4, 8 })
+	{
+		if (rc6_cipher_t::set_lanes(lanes) != lanes)
+		{
+			continue;
+		}
+
+		rc6_cipher_t cipher(make_key());
+
+		// 64 KB messages (decrypted in place by the receiver)
+		std::vector<cipher_block_t> data(0x10000 / 16);
+
+		run("decrypt_cbc 64 KB", lanes, megabytes, data.size(), [&]()
+		{
+			cipher.decrypt_cbc(data.data(), data.size());
+		});
+
+		// CTR mode keystream batch (cipher_ctr_t generates 64 blocks at once)
+		run("make_keystream 64 blocks", lanes, megabytes, 64, [&]()
+		{
+			cipher.make_keystream(data.data(), 64, 0, 1);
+		});
+
+		// broadcast of small frames: 64 clients with 4 blocks each
+		std::vector<std::unique_ptr<rc6_cipher_t>> ciphers;
+		std::vector<cipher_job_t> jobs;
+
+		for (u32 i = 0; i < 64; i++)
+		{
+			ciphers.emplace_back(new rc6_cipher_t(make_key()));
+			jobs.push_back({ ciphers.back().get(), data.data() + i * 4, 4 });
+		}
+
+		run("encrypt_cbc_batch 64x4", lanes, megabytes, 64 * 4, [&]()
+		{
+			rc6_cipher_t::encrypt_cbc_batch(jobs.data(), jobs.size());
+		});
+	}
+
+	return 0;
+}
@@ -0,0 +1,172 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "aes.h"
+
+// Known-answer tests of aes_cipher_t (FIPS-197 C.1, SP 800-38A F.2.1) and CBC/CTR consistency checks
+
+namespace
+{
+	u8 parse_hex(char c)
+	{
+		return static_cast<u8>(c <= '9' ? c - '0' : c - 'a' + 10);
+	}
+
+	void parse(void* dst, const char* hex)
+	{
+		for (auto ptr = static_cast<u8*>(dst); *hex; hex += 2)
+		{
+			*ptr++ = static_cast<u8>(parse_hex(hex[0]) << 4 | parse_hex(hex[1]));
+		}
+	}
+
+	// key and initialization vector
+	packet_t make_key(const char* key, const char* iv)
+	{
+		packet_t result(32);
+		parse(&result->get(0), key);
+		parse(&result->get(16), iv);
+		return result;
+	}
+
+	std::vector<cipher_block_t> make_blocks(std::initializer_list<const char*> hex)
+	{
+		std::vector<cipher_block_t> blocks;
+
+		for (const auto str : hex)
+		{
+			blocks.emplace_back();
+			parse(&blocks.back(), str);
+		}
+
+		return blocks;
+	}
+
+	bool equal(const std::vector<cipher_block_t>& a, const std::vector<cipher_block_t>& b)
+	{
+		return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(cipher_block_t)) == 0;
+	}
+
+	bool result(const char* name, bool ok)
+	{
+		fmt::print("{}: {}\n", name, ok ? "OK" : "FAILED");
+		return ok;
+	}
+
+	// single block with zero initialization vector (CBC is equal to ECB)
+	bool test_fips197()
+	{
+		const packet_t key = make_key("000102030405060708090a0b0c0d0e0f", "00000000000000000000000000000000");
+		const auto plain = make_blocks({ "00112233445566778899aabbccddeeff" });
+		const auto cipher = make_blocks({ "69c4e0d86a7b0430d8cdb78070b4c55a" });
+
+		auto data = plain;
+		aes_cipher_t(key).encrypt_cbc(data.data(), data.size());
+
+		const bool encrypted = equal(data, cipher);
+
+		aes_cipher_t(key).decrypt_cbc(data.data(), data.size());
+
+		return result("FIPS-197 C.1", encrypted && equal(data, plain));
+	}
+
+	// CBC-AES128 (encrypted in one call, decrypted block by block)
+	bool test_sp800_38a()
+	{
+		const packet_t key = make_key("2b7e151628aed2a6abf7158809cf4f3c", "000102030405060708090a0b0c0d0e0f");
+
+		const auto plain = make_blocks(
+		{
+			"6bc1bee22e409f96e93d7e117393172a",
+			"ae2d8a571e03ac9c9eb76fac45af8e51",
+			"30c81c46a35ce411e5fbc1191a0a52ef",
+			"f69f2445df4f9b17ad2b417be66c3710",
+		});
+
+		const auto cipher = make_blocks(
+		{
+			"7649abac8119b246cee98e9b12e9197d",
+			"5086cb9b507219ee95db113a917678b2",
+			"73bed6b8e3c1743b7116e69e22229516",
+			"3ff1caa1681fac09120eca307586e1a7",
+		});
+
+		auto data = plain;
+		aes_cipher_t(key).encrypt_cbc(data.data(), data.size());
+
+		const bool encrypted = equal(data, cipher);
+
+		aes_cipher_t decryptor(key);
+
+		for (auto& block : data)
+		{
+			decryptor.decrypt_cbc(&block, 1);
+		}
+
+		return result("SP 800-38A F.2.1", encrypted && equal(data, plain));
+	}
+
+	// parallel decryption (8 blocks at once) with split calls and keystream compared with single block encryption
+	bool test_consistency()
+	{
+		const packet_t key = make_key("000102030405060708090a0b0c0d0e0f", "f0e0d0c0b0a090807060504030201000");
+
+		std::vector<cipher_block_t> plain(37);
+
+		for (u32 i = 0; i < plain.size(); i++)
+		{
+			plain[i].vi = _mm_set_epi32(i * 4 + 3, i * 4 + 2, i * 4 + 1, i * 4);
+		}
+
+		auto encrypted = plain;
+		aes_cipher_t(key).encrypt_cbc(encrypted.data(), encrypted.size());
+
+		bool ok = true;
+
+		for (std::size_t split = 0; split <= plain.size(); split++)
+		{
+			auto data = encrypted;
+
+			aes_cipher_t cipher(key);
+			cipher.decrypt_cbc(data.data(), split);
+			cipher.decrypt_cbc(data.data() + split, data.size() - split);
+
+			ok &= equal(data, plain);
+		}
+
+		const packet_t ecb_key = make_key("000102030405060708090a0b0c0d0e0f", "00000000000000000000000000000000");
+
+		std::vector<cipher_block_t> keys(plain.size());
+		aes_cipher_t(ecb_key).make_keystream(keys.data(), keys.size(), 0xfffffff0, 1);
+
+		for (u32 i = 0; i < keys.size(); i++)
+		{
+			const u64 counter = 0xfffffff0 + u64{ i };
+
+			std::vector<cipher_block_t> block(1);
+			block[0].vi = _mm_set_epi32(0, 1, static_cast<u32>(counter >> 32), static_cast<u32>(counter));
+
+			aes_cipher_t(ecb_key).encrypt_cbc(block.data(), 1);
+
+			ok &= std::memcmp(&block[0], &keys[i], sizeof(cipher_block_t)) == 0;
+		}
+
+		return result("CBC and CTR consistency", ok);
+	}
+}
+
+int main()
+{
+	if (!aes_cipher_t::is_supported())
+	{
+		fmt::print("AES-NI is not supported, skipped\n");
+		return 0;
+	}
+
+	bool ok = true;
+
+	ok &= test_fips197();
+	ok &= test_sp800_38a();
+	ok &= test_consistency();
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,379 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_listener.h"
+#include "ep_broadcast.h"
+
+// Stress test of listener_t queue: lock-free producers with parked (threaded mode) or signaled (reactor mode) consumer
+// Broadcast ring: parked consumers woken up after publish, callbacks removed by unsubscribe()
+
+namespace
+{
+	const u32 producer_count = 8;
+	const u32 packet_count = 100000; // per producer
+
+	packet_t make_packet(u32 producer, u32 seq)
+	{
+		packet_t packet(8);
+		packet->get<u32>(0) = producer;
+		packet->get<u32>(4) = seq;
+		return packet;
+	}
+
+	// checks that packets of each producer arrive in order and nothing is lost
+	struct checker_t
+	{
+		std::vector<u32> next = std::vector<u32>(producer_count);
+		u64 received = 0;
+		u64 errors = 0;
+
+		void check(const packet_t& packet)
+		{
+			if (!packet || packet->size != 8)
+			{
+				errors++;
+				return;
+			}
+
+			const u32 producer = packet->get<u32>(0);
+			const u32 seq = packet->get<u32>(4);
+
+			if (producer >= producer_count || next[producer] != seq)
+			{
+				errors++;
+				return;
+			}
+
+			next[producer]++;
+			received++;
+		}
+
+		bool result(const char* name, u64 expected = u64{ producer_count } * packet_count) const
+		{
+			const bool ok = errors == 0 && received == expected;
+			fmt::print("{}: {} received, {} errors: {}\n", name, received, errors, ok ? "OK" : "FAILED");
+			return ok;
+		}
+	};
+
+	void run_producers(listener_t& listener)
+	{
+		std::vector<std::thread> threads;
+
+		for (u32 i = 0; i < producer_count; i++)
+		{
+			threads.emplace_back([&listener, i]()
+			{
+				for (u32 seq = 0; seq < packet_count; seq++)
+				{
+					listener.push_packet(make_packet(i, seq));
+
+					if (seq % 1024 == 0)
+					{
+						std::this_thread::yield(); // let the consumer park sometimes
+					}
+				}
+			});
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	// threaded mode: the consumer sleeps in pop_all(), the stop message must be the last one
+	bool test_parked()
+	{
+		listener_t listener(0, 0, false);
+		checker_t checker;
+		bool stopped = false;
+
+		std::thread consumer([&]()
+		{
+			std::vector<packet_t> packets;
+
+			while (!stopped)
+			{
+				packets.clear();
+				listener.pop_all(packets);
+
+				for (const auto& packet : packets)
+				{
+					if (stopped)
+					{
+						checker.errors++; // packet after the stop message
+					}
+					else if (!packet)
+					{
+						stopped = true;
+					}
+					else
+					{
+						checker.check(packet);
+					}
+				}
+			}
+		});
+
+		run_producers(listener);
+		listener.stop();
+		consumer.join();
+
+		return checker.result("parked consumer");
+	}
+
+	// reactor mode: the consumer is signaled when the queue becomes non-empty and drains it without waiting
+	bool test_signaled()
+	{
+		listener_t listener(0, 0, false);
+		checker_t checker;
+
+		std::mutex mutex;
+		std::condition_variable cond;
+		bool signaled = false;
+
+		listener.set_signal([&]()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			signaled = true;
+			cond.notify_one();
+		});
+
+		bool lost_wakeup = false;
+
+		std::thread consumer([&]()
+		{
+			std::vector<packet_t> packets;
+
+			while (checker.received < u64{ producer_count } * packet_count && !checker.errors)
+			{
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+
+					if (!cond.wait_for(lock, std::chrono::seconds(10), [&] { return signaled; }))
+					{
+						lost_wakeup = true;
+						return;
+					}
+
+					signaled = false;
+				}
+
+				while (listener.try_pop_all(packets))
+				{
+					for (const auto& packet : packets)
+					{
+						checker.check(packet);
+					}
+
+					packets.clear();
+				}
+			}
+		});
+
+		run_producers(listener);
+		consumer.join();
+
+		if (lost_wakeup)
+		{
+			fmt::print("signaled consumer: lost wake-up\n");
+		}
+
+		return checker.result("signaled consumer") && !lost_wakeup;
+	}
+
+	// threaded mode with broadcast ring: consumers parked in pop_all() must be woken up after every publish
+	bool test_broadcast()
+	{
+		const u32 consumer_count = 64;
+		const u32 round_count = 10;
+		const u32 round_size = 500; // per producer (a round doesn't fill the ring, so consumers aren't lapped)
+
+		static char player; // never dereferenced (broadcast packets have no filter)
+
+		std::vector<std::unique_ptr<listener_t>> listeners;
+		std::vector<checker_t> checkers(consumer_count);
+		std::vector<std::thread> consumers;
+		std::atomic<u64> received{ 0 };
+
+		for (u32 i = 0; i < consumer_count; i++)
+		{
+			listeners.emplace_back(new listener_t(0, 0, false));
+			listeners.back()->attach(reinterpret_cast<player_t*>(&player));
+		}
+
+		for (u32 i = 0; i < consumer_count; i++)
+		{
+			consumers.emplace_back([&, i]()
+			{
+				std::vector<packet_t> packets;
+
+				for (bool stopped = false; !stopped;)
+				{
+					packets.clear();
+					listeners[i]->pop_all(packets);
+
+					for (const auto& packet : packets)
+					{
+						if (!packet)
+						{
+							stopped = true;
+							break;
+						}
+
+						checkers[i].check(packet);
+						received++;
+					}
+				}
+			});
+		}
+
+		bool lost_wakeup = false;
+
+		for (u32 round = 1; round <= round_count && !lost_wakeup; round++)
+		{
+			std::vector<std::thread> producers;
+
+			for (u32 p = 0; p < producer_count; p++)
+			{
+				producers.emplace_back([&, round, p]()
+				{
+					for (u32 seq = (round - 1) * round_size; seq < round * round_size; seq++)
+					{
+						g_broadcast.publish(make_packet(p, seq));
+					}
+				});
+			}
+
+			for (auto& thread : producers)
+			{
+				thread.join();
+			}
+
+			// wait until every consumer has taken the whole round
+			const u64 expected = u64{ round } * round_size * producer_count * consumer_count;
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+			while (received.load() < expected && !(lost_wakeup = std::chrono::steady_clock::now() > deadline))
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+
+		for (auto& listener : listeners)
+		{
+			listener->stop();
+		}
+
+		for (auto& thread : consumers)
+		{
+			thread.join();
+		}
+
+		checker_t total;
+
+		for (const auto& checker : checkers)
+		{
+			total.received += checker.received;
+			total.errors += checker.errors;
+		}
+
+		if (lost_wakeup)
+		{
+			fmt::print("broadcast: lost wake-up\n");
+		}
+
+		return total.result("broadcast", u64{ round_count } * round_size * producer_count * consumer_count) && !lost_wakeup;
+	}
+
+	// a callback isn't running or called after unsubscribe() returns (publishers run concurrently)
+	bool test_unsubscribe()
+	{
+		std::atomic<u64> calls{ 0 };
+		std::atomic<u32> running{ 0 };
+		std::atomic<bool> done{ false };
+
+		const u64 id = g_broadcast.subscribe([&]()
+		{
+			running++;
+			calls++;
+			std::this_thread::yield();
+			running--;
+		});
+
+		std::vector<std::thread> producers;
+
+		for (u32 p = 0; p < producer_count; p++)
+		{
+			producers.emplace_back([&, p]()
+			{
+				for (u32 seq = 0; !done.load(); seq++)
+				{
+					g_broadcast.publish(make_packet(p, seq));
+				}
+			});
+		}
+
+		while (calls.load() < 1000)
+		{
+			std::this_thread::yield();
+		}
+
+		g_broadcast.unsubscribe(id);
+
+		const bool idle = running.load() == 0;
+		const u64 before = calls.load();
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+		done = true;
+
+		for (auto& thread : producers)
+		{
+			thread.join();
+		}
+
+		const bool ok = idle && calls.load() == before;
+		fmt::print("unsubscribe: {} calls: {}\n", before, ok ? "OK" : "FAILED");
+		return ok;
+	}
+
+	// the queue limit discards new packets and disconnects the consumer (resync is disabled)
+	bool test_overflow()
+	{
+		listener_t listener(0, 0, false);
+
+		g_queue_limit = 100;
+
+		for (u32 i = 0; i < 150; i++)
+		{
+			listener.push_packet(make_packet(0, i));
+		}
+
+		g_queue_limit = 0;
+
+		std::vector<packet_t> packets;
+		listener.try_pop_all(packets);
+
+		const bool ok = !packets.empty() && !packets.back();
+		fmt::print("overflow: {} packets: {}\n", packets.size(), ok ? "OK" : "FAILED");
+		return ok;
+	}
+}
+
+int main()
+{
+	// unlimited queues unless a test sets the limit
+	g_queue_limit = 0;
+	g_queue_size_limit = 0;
+
+	bool ok = true;
+
+	ok &= test_parked();
+	ok &= test_signaled();
+	ok &= test_broadcast();
+	ok &= test_overflow();
+	ok &= test_unsubscribe();
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "md5.h"
+
+#include <random>
+
+// md5_hasher_t tests: RFC 1321 test suite, split update() calls and hash_batch() compared with hash()
+
+namespace
+{
+	std::string to_hex(const md5_t& hash)
+	{
+		std::string result;
+
+		for (const auto byte : hash)
+		{
+			result += fmt::format("{:02x}", byte);
+		}
+
+		return result;
+	}
+
+	struct checker_t
+	{
+		u64 checks = 0;
+		u64 errors = 0;
+
+		void check(bool ok)
+		{
+			checks++;
+			errors += !ok;
+		}
+
+		bool result(const char* name) const
+		{
+			fmt::print("{}: {} checks, {} errors: {}\n", name, checks, errors, errors ? "FAILED" : "OK");
+			return !errors;
+		}
+	};
+
+	// RFC 1321 A.5
+	const std::pair<const char*, const char*> rfc1321[] =
+	{
+		{ "", "d41d8cd98f00b204e9800998ecf8427e" },
+		{ "a", "0cc175b9c0f1b6a831c399e269772661" },
+		{ "abc", "900150983cd24fb0d6963f7d28e17f72" },
+		{ "message digest", "f96b697d7cb7938d525a2f31aaf161d0" },
+		{ "abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b" },
+		{ "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f" },
+		{ "12345678901234567890123456789012345678901234567890123456789012345678901234567890", "57edf4a22be3c955ac49da2e2107b67a" },
+	};
+
+	bool test_rfc1321()
+	{
+		checker_t checker;
+
+		for (const auto& test : rfc1321)
+		{
+			checker.check(to_hex(md5_hasher_t::hash(test.first, std::strlen(test.first))) == test.second);
+		}
+
+		return checker.result("RFC 1321");
+	}
+
+	// data is passed in two parts split at every position, and byte by byte (the hasher is reused after reset())
+	bool test_split()
+	{
+		checker_t checker;
+
+		std::string data;
+
+		for (u32 i = 0; i < 200; i++)
+		{
+			data += static_cast<char>(i * 31 + 7);
+		}
+
+		md5_hasher_t hasher;
+
+		for (std::size_t size = 0; size <= data.size(); size++)
+		{
+			const md5_t expected = md5_hasher_t::hash(data.data(), size);
+
+			for (std::size_t split = 0; split <= size; split++)
+			{
+				hasher.reset();
+				hasher.update(data.data(), split);
+				hasher.update(data.data() + split, size - split);
+				checker.check(hasher.finish() == expected);
+			}
+
+			hasher.reset();
+
+			for (std::size_t i = 0; i < size; i++)
+			{
+				hasher.update(&data[i], 1);
+			}
+
+			checker.check(hasher.finish() == expected);
+		}
+
+		// RFC 1321 vector of 80 bytes in parts
+		hasher.reset();
+		hasher.update(rfc1321[6].first, 10);
+		hasher.update(rfc1321[6].first + 10, 60);
+		hasher.update(rfc1321[6].first + 70, 10);
+		checker.check(to_hex(hasher.finish()) == rfc1321[6].second);
+
+		return checker.result("split update");
+	}
+
+	// batch sizes 1..17 (partially filled SIMD lanes included)
+	bool test_batch()
+	{
+		checker_t checker;
+
+		std::mt19937 rng;
+
+		for (std::size_t count = 1; count <= 17; count++)
+		{
+			std::vector<md5_t> input(count), output(count);
+
+			for (auto& value : input)
+			{
+				for (auto& byte : value)
+				{
+					byte = static_cast<u8>(rng());
+				}
+			}
+
+			md5_hasher_t::hash_batch(input.data(), output.data(), count);
+
+			for (std::size_t i = 0; i < count; i++)
+			{
+				checker.check(output[i] == md5_hasher_t::hash(input[i].data(), input[i].size()));
+			}
+		}
+
+		return checker.result("hash_batch");
+	}
+}
+
+int main()
+{
+	bool ok = true;
+
+	ok &= test_rfc1321();
+	ok &= test_split();
+	ok &= test_batch();
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_account.h"
+#include "ep_player.h"
+#include "ep_listener.h"
+
+// Presence index tests: player_list_t::is_online() and only_online() after connection, hide/show, flag changes and slot reuse
+
+player_list_t g_players;
+
+namespace
+{
+	struct checker_t
+	{
+		u64 checks = 0;
+		u64 errors = 0;
+
+		void check(bool ok)
+		{
+			checks++;
+			errors += !ok;
+		}
+
+		bool result(const char* name) const
+		{
+			fmt::print("{}: {} checks, {} errors: {}\n", name, checks, errors, errors ? "FAILED" : "OK");
+			return !errors;
+		}
+	};
+
+	std::shared_ptr<listener_t> make_listener()
+	{
+		return std::make_shared<listener_t>(0, 0, false);
+	}
+
+	// player is online in the index and passes the broadcast filter
+	bool online(player_t& player)
+	{
+		return g_players.is_online(player.index) && only_online(player);
+	}
+
+	// online player count from server statistics
+	u32 online_count()
+	{
+		std::string info;
+		g_players.append_stats(info);
+
+		return static_cast<u32>(std::stoul(info.substr(info.find(", ") + 2)));
+	}
+
+	// the player is online while it has connections
+	bool test_connect()
+	{
+		checker_t checker;
+
+		const auto player = g_players.add_player(std::make_shared<account_t>());
+		player->account->flags = 0;
+
+		const auto first = make_listener();
+		const auto second = make_listener();
+
+		checker.check(!online(*player));
+		checker.check(player->add_listener(first) && online(*player));
+		checker.check(player->add_listener(second) && online(*player));
+		checker.check(online_count() == 1);
+		checker.check(player->remove_listener(first) == PS_CONNECTED && online(*player));
+		checker.check(player->remove_listener(second) == PS_CONNECTION_LOST && !online(*player));
+		checker.check(online_count() == 0);
+
+		g_players.remove_player(player->index);
+
+		return checker.result("connect");
+	}
+
+	// PF_OFF flag set by hide/show commands (session_t::set_offline, set_online) and by SET_FLAG
+	bool test_hide()
+	{
+		checker_t checker;
+
+		const auto player = g_players.add_player(std::make_shared<account_t>());
+		player->account->flags = 0;
+
+		// hidden player connects
+		player->account->flags |= PF_OFF;
+
+		const auto listener = make_listener();
+
+		checker.check(player->add_listener(listener) && !online(*player));
+
+		// show
+		player->account->flags &= ~PF_OFF;
+		player->update_presence();
+		checker.check(online(*player) && online_count() == 1);
+
+		// hide
+		player->account->flags |= PF_OFF;
+		player->update_presence();
+		checker.check(!online(*player) && online_count() == 0);
+
+		// SET_FLAG toggles PF_OFF of an online player (other flags don't matter)
+		player->account->flags ^= PF_OFF;
+		player->update_presence();
+		checker.check(online(*player));
+
+		player->account->flags ^= PF_NOCONNECT;
+		player->update_presence();
+		checker.check(online(*player) && online_count() == 1);
+
+		player->account->flags ^= PF_OFF;
+		player->update_presence();
+		checker.check(!online(*player) && online_count() == 0);
+
+		// repeated updates don't change the count
+		player->update_presence();
+		player->account->flags ^= PF_OFF;
+		player->update_presence();
+		player->update_presence();
+		checker.check(online(*player) && online_count() == 1);
+
+		player->remove_listener(listener);
+		checker.check(!online(*player) && online_count() == 0);
+
+		g_players.remove_player(player->index);
+
+		return checker.result("hide and show");
+	}
+
+	// a removed player can't change the bit of a new player in the same slot
+	bool test_reuse()
+	{
+		checker_t checker;
+
+		const auto old_player = g_players.add_player(std::make_shared<account_t>());
+		old_player->account->flags = 0;
+
+		const auto old_listener = make_listener();
+
+		checker.check(old_player->add_listener(old_listener) && online(*old_player));
+
+		// quit (session_t::disconnect)
+		old_player->remove_listener(old_listener);
+		g_players.remove_player(old_player->index);
+
+		const auto player = g_players.add_player(std::make_shared<account_t>());
+		player->account->flags = 0;
+
+		checker.check(player->index == old_player->index && !online(*player));
+
+		const auto listener = make_listener();
+
+		checker.check(player->add_listener(listener) && online(*player));
+
+		// late updates of the old player (e.g. flag change by a command executed before it quit)
+		old_player->account->flags ^= PF_OFF;
+		old_player->update_presence();
+		old_player->account->flags ^= PF_OFF;
+		old_player->update_presence();
+		old_player->remove_listener(old_listener);
+
+		checker.check(online(*player) && online_count() == 1);
+
+		player->remove_listener(listener);
+		checker.check(!online(*player) && online_count() == 0);
+
+		g_players.remove_player(player->index);
+
+		return checker.result("slot reuse");
+	}
+}
+
+int main()
+{
+	bool ok = true;
+
+	ok &= test_connect();
+	ok &= test_hide();
+	ok &= test_reuse();
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,201 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "rc6.h"
+
+#include <random>
+
+// Comparison of rc6_cipher_t SIMD kernels (4 and 8 lanes) with the scalar implementation
+
+namespace
+{
+	std::mt19937 g_rng;
+
+	packet_t make_key(u32 size)
+	{
+		packet_t key(size);
+
+		for (u32 i = 0; i < size; i++)
+		{
+			key->get<u8>(i) = static_cast<u8>(g_rng());
+		}
+
+		return key;
+	}
+
+	std::vector<cipher_block_t> make_blocks(std::size_t count)
+	{
+		std::vector<cipher_block_t> blocks(count);
+
+		for (auto& block : blocks)
+		{
+			for (auto& word : block.i)
+			{
+				word = g_rng();
+			}
+		}
+
+		return blocks;
+	}
+
+	bool equal(const std::vector<cipher_block_t>& a, const std::vector<cipher_block_t>& b)
+	{
+		return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(cipher_block_t)) == 0);
+	}
+
+	struct checker_t
+	{
+		u64 checks = 0;
+		u64 errors = 0;
+
+		void check(bool ok)
+		{
+			checks++;
+			errors += !ok;
+		}
+
+		bool result(const char* name, u32 lanes) const
+		{
+			fmt::print("{} ({} lanes): {} checks, {} errors: {}\n", name, lanes, checks, errors, errors ? "FAILED" : "OK");
+			return !errors;
+		}
+	};
+
+	// CBC decryption in one or two calls (chaining state must be carried between calls)
+	bool test_decrypt(u32 lanes)
+	{
+		checker_t checker;
+
+		for (u32 key_size : { 16, 32, 64 })
+		{
+			for (std::size_t count = 0; count <= lanes * 3 + 3; count++)
+			{
+				const packet_t key = make_key(key_size);
+				const auto plain = make_blocks(count);
+
+				auto encrypted = plain;
+				rc6_cipher_t(key).encrypt_cbc(encrypted.data(), count);
+
+				for (std::size_t split = 0; split <= count; split++)
+				{
+					auto scalar = encrypted;
+					auto simd = encrypted;
+
+					rc6_cipher_t::set_lanes(0);
+					rc6_cipher_t scalar_cipher(key);
+					scalar_cipher.decrypt_cbc(scalar.data(), split);
+					scalar_cipher.decrypt_cbc(scalar.data() + split, count - split);
+
+					rc6_cipher_t::set_lanes(lanes);
+					rc6_cipher_t simd_cipher(key);
+					simd_cipher.decrypt_cbc(simd.data(), split);
+					simd_cipher.decrypt_cbc(simd.data() + split, count - split);
+
+					checker.check(equal(scalar, plain) && equal(simd, plain));
+				}
+			}
+		}
+
+		return checker.result("decrypt_cbc", lanes);
+	}
+
+	// CTR keystream (the counter crosses 32-bit boundary)
+	bool test_keystream(u32 lanes)
+	{
+		checker_t checker;
+
+		for (u64 counter : { u64{ 0 }, u64{ 0xfffffff0 }, u64{ 0x123456789abcdef } })
+		{
+			const rc6_cipher_t cipher(make_key(32));
+
+			for (std::size_t count = 1; count <= lanes * 4 + 3; count++)
+			{
+				auto scalar = make_blocks(count);
+				auto simd = make_blocks(count);
+
+				rc6_cipher_t::set_lanes(0);
+				cipher.make_keystream(scalar.data(), count, counter, 1);
+
+				rc6_cipher_t::set_lanes(lanes);
+				cipher.make_keystream(simd.data(), count, counter, 1);
+
+				checker.check(equal(scalar, simd));
+			}
+		}
+
+		return checker.result("make_keystream", lanes);
+	}
+
+	// batch encryption of independent ciphers (empty jobs included), compared with separate encrypt_cbc() calls
+	bool test_batch(u32 lanes)
+	{
+		checker_t checker;
+
+		for (u32 cipher_count = 1; cipher_count <= lanes * 3; cipher_count++)
+		{
+			std::vector<std::unique_ptr<rc6_cipher_t>> scalar_ciphers, simd_ciphers;
+			std::vector<std::vector<cipher_block_t>> scalar, simd;
+			std::vector<cipher_job_t> jobs;
+
+			for (u32 i = 0; i < cipher_count; i++)
+			{
+				const packet_t key = make_key(16);
+
+				scalar_ciphers.emplace_back(new rc6_cipher_t(key));
+				simd_ciphers.emplace_back(new rc6_cipher_t(key));
+				scalar.emplace_back(make_blocks(g_rng() % 13));
+				simd.emplace_back(scalar.back());
+			}
+
+			for (u32 i = 0; i < cipher_count; i++)
+			{
+				jobs.push_back({ simd_ciphers[i].get(), simd[i].data(), simd[i].size() });
+			}
+
+			rc6_cipher_t::set_lanes(0);
+
+			for (u32 i = 0; i < cipher_count; i++)
+			{
+				scalar_ciphers[i]->encrypt_cbc(scalar[i].data(), scalar[i].size());
+			}
+
+			rc6_cipher_t::set_lanes(lanes);
+			rc6_cipher_t::encrypt_cbc_batch(jobs.data(), jobs.size());
+
+			for (u32 i = 0; i < cipher_count; i++)
+			{
+				// the next block checks the chaining state
+				auto scalar_next = make_blocks(1);
+				auto simd_next = scalar_next;
+
+				scalar_ciphers[i]->encrypt_cbc(scalar_next.data(), 1);
+				simd_ciphers[i]->encrypt_cbc(simd_next.data(), 1);
+
+				checker.check(equal(scalar[i], simd[i]) && equal(scalar_next, simd_next));
+			}
+		}
+
+		return checker.result("encrypt_cbc_batch", lanes);
+	}
+}
+
+int main()
+{
+	fmt::print("CPU supports {} lanes\n", rc6_cipher_t::get_lanes());
+
+	bool ok = true;
+
+	for (u32 lanes : { 4, 8 })
+	{
+		if (rc6_cipher_t::set_lanes(lanes) != lanes)
+		{
+			fmt::print("{} lanes: not supported, skipped\n", lanes);
+			continue;
+		}
+
+		ok &= test_decrypt(lanes);
+		ok &= test_keystream(lanes);
+		ok &= test_batch(lanes);
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include "stdafx.h"
+#include "ep_defines.h"
+#include "ep_rsa.h"
+
+// rsa_decrypt() tests: textbook key, results compared with full exponentiation, leading zeros, zero and oversized results
+
+namespace
+{
+	struct checker_t
+	{
+		u64 checks = 0;
+		u64 errors = 0;
+
+		void check(bool ok)
+		{
+			checks++;
+			errors += !ok;
+		}
+
+		bool result(const char* name) const
+		{
+			fmt::print("{}: {} checks, {} errors: {}\n", name, checks, errors, errors ? "FAILED" : "OK");
+			return !errors;
+		}
+	};
+
+	// value in base 256 (right-aligned)
+	packet_t to_data(const mpz_class& value, std::size_t size)
+	{
+		packet_t data(size);
+		std::memset(data->data(), 0, size);
+
+		mpz_export(&data->get(size - mpz_sizeinbase(value.get_mpz_t(), 256)), nullptr, 1, 1, 1, 0, value.get_mpz_t());
+
+		return data;
+	}
+
+	bool equal(const packet_t& data, std::initializer_list<u8> bytes)
+	{
+		return data && data->size == bytes.size() && std::equal(bytes.begin(), bytes.end(), static_cast<const u8*>(data->data()));
+	}
+
+	mpz_class make_prime(gmp_randclass& rng, u32 bits)
+	{
+		mpz_class result = rng.get_z_bits(bits);
+		mpz_setbit(result.get_mpz_t(), bits - 1);
+		mpz_nextprime(result.get_mpz_t(), result.get_mpz_t());
+		return result;
+	}
+
+	// p = 61, q = 53, e = 17 (n = 3233, d = 2753)
+	bool test_textbook()
+	{
+		checker_t checker;
+
+		rsa_key_t key;
+		key.set(17, 61, 53);
+
+		checker.check(key.n == 3233 && key.d == 2753 && key.size == sizeof(mp_limb_t));
+
+		// 65 ^ 17 mod 3233 = 2790
+		checker.check(equal(rsa_decrypt(key, to_data(2790, key.size)), { 65 }));
+
+		// two-byte result, leading zeros are removed
+		mpz_class encrypted;
+		mpz_powm_ui(encrypted.get_mpz_t(), mpz_class(3000).get_mpz_t(), 17, key.n.get_mpz_t());
+		checker.check(equal(rsa_decrypt(key, to_data(encrypted, key.size)), { 0x0b, 0xb8 }));
+
+		// zero is returned as one zero byte
+		checker.check(equal(rsa_decrypt(key, to_data(0, key.size)), { 0 }));
+
+		// n is longer than one byte: 2 ^ 2753 mod 3233 = 1027 doesn't fit, 1 does
+		key.size = 1;
+		checker.check(!rsa_decrypt(key, to_data(2, key.size)));
+		checker.check(equal(rsa_decrypt(key, to_data(1, key.size)), { 1 }));
+
+		return checker.result("textbook key");
+	}
+
+	// random keys and messages, decrypted with d without CRT
+	bool test_random()
+	{
+		checker_t checker;
+
+		gmp_randclass rng(gmp_randinit_default);
+
+		for (u32 bits : { 512, 1024, 2048 })
+		{
+			rsa_key_t key;
+
+			do
+			{
+				key.set(65537, make_prime(rng, bits / 2), make_prime(rng, bits / 2));
+			}
+			while (key.p == key.q || key.d * 65537 % ((key.p - 1) * (key.q - 1)) != 1);
+
+			for (u32 i = 0; i < 20; i++)
+			{
+				// short messages have leading zero bytes (n has at least bits - 1 bits)
+				const mpz_class message = rng.get_z_bits(i % 2 ? bits - 2 : bits / 2 - i * 8);
+
+				mpz_class encrypted, expected;
+				mpz_powm_ui(encrypted.get_mpz_t(), message.get_mpz_t(), 65537, key.n.get_mpz_t());
+				mpz_powm(expected.get_mpz_t(), encrypted.get_mpz_t(), key.d.get_mpz_t(), key.n.get_mpz_t());
+
+				const packet_t result = rsa_decrypt(key, to_data(encrypted, key.size));
+
+				checker.check(expected == message && result);
+
+				if (result)
+				{
+					mpz_class decrypted;
+					mpz_import(decrypted.get_mpz_t(), result->size, 1, 1, 1, 0, result->data());
+
+					checker.check(decrypted == message && (result->size == 1 || result->get<u8>(0) != 0));
+				}
+			}
+		}
+
+		return checker.result("random keys");
+	}
+}
+
+int main()
+{
+	bool ok = true;
+
+	ok &= test_textbook();
+	ok &= test_random();
+
+	return ok ? 0 : 1;
+}